@@ -0,0 +1,19 @@
+#include "allocator.h"
+
+#include <stdlib.h>
+
+static void* heap_alloc(void* const state, const size_t size) {
+    (void)state;
+    return malloc(size);
+}
+
+static void heap_free(void* const state, void* const ptr) {
+    (void)state;
+    free(ptr);
+}
+
+const struct rome_allocator rome_heap_allocator = {
+    .alloc = heap_alloc,
+    .free = heap_free,
+    .state = NULL,
+};
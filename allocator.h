@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+
+// Allocator interface used for every allocation the library performs (currently only error messages).
+// state is passed back verbatim to both callbacks, so one allocator can serve one thread without any shared state.
+struct rome_allocator {
+    void* (*alloc)(void* state, size_t size);
+    void (*free)(void* state, void* ptr);
+    void* state;
+};
+
+// Allocator backed by malloc and free. It is stateless and can be shared by all threads.
+extern const struct rome_allocator rome_heap_allocator;
@@ -0,0 +1,92 @@
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+struct rome_arena_block {
+    struct rome_arena_block* next;
+    size_t size;
+    alignas(max_align_t) char data[];
+};
+
+static void* arena_alloc(void* const state, const size_t size) {
+    return rome_arena_alloc((struct rome_arena*)state, size);
+}
+
+static void arena_free(void* const state, void* const ptr) {
+    // Memory is released in bulk by rome_arena_reset
+    (void)state;
+    (void)ptr;
+}
+
+void rome_arena_init(struct rome_arena* const arena, const size_t block_size) {
+    *arena = (struct rome_arena) {
+        .allocator = {.alloc = arena_alloc, .free = arena_free, .state = arena},
+        .first = NULL,
+        .current = NULL,
+        .used = 0,
+        .block_size = block_size,
+    };
+}
+
+static struct rome_arena_block* new_block(const size_t size) {
+    struct rome_arena_block* const block = malloc(sizeof(struct rome_arena_block) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    return block;
+}
+
+void* rome_arena_alloc(struct rome_arena* const arena, size_t size) {
+    const size_t align = alignof(max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+
+    if (arena->current != NULL && arena->current->size - arena->used >= size) {
+        void* const ptr = arena->current->data + arena->used;
+        arena->used += size;
+        return ptr;
+    }
+
+    // Move on to the next block kept from before the last reset, if it is large enough
+    struct rome_arena_block* const next = arena->current ? arena->current->next : arena->first;
+    if (next != NULL && next->size >= size) {
+        arena->current = next;
+        arena->used = size;
+        return next->data;
+    }
+
+    // Insert a fresh block after the current one
+    struct rome_arena_block* const block = new_block(size > arena->block_size ? size : arena->block_size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = next;
+    if (arena->current != NULL) {
+        arena->current->next = block;
+    } else {
+        arena->first = block;
+    }
+
+    arena->current = block;
+    arena->used = size;
+    return block->data;
+}
+
+void rome_arena_reset(struct rome_arena* const arena) {
+    // Rewinding to before the first block makes the next allocation walk the chain from the start
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+void rome_arena_destroy(struct rome_arena* const arena) {
+    struct rome_arena_block* block = arena->first;
+    while (block != NULL) {
+        struct rome_arena_block* const next = block->next;
+        free(block);
+        block = next;
+    }
+    rome_arena_init(arena, arena->block_size);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "allocator.h"
+
+struct rome_arena_block;
+
+// Bump allocator for error messages.
+// Allocations are carved out of large heap blocks and are only released all at once, with rome_arena_reset. Blocks are
+// kept across resets, so a long-running loop settles on a fixed set of blocks and stops calling malloc altogether.
+//
+// An arena is not thread-safe: bind one to each thread (or to each parse call) through its context, e.g.
+//     ctx.allocator = &arena.allocator;
+struct rome_arena {
+    struct rome_allocator allocator;  // Allocator interface backed by this arena. Its free is a no-op.
+    struct rome_arena_block* first;   // First block in the chain, NULL until the first allocation
+    struct rome_arena_block* current; // Block allocations are served from
+    size_t used;                      // Bytes used in the current block
+    size_t block_size;                // Minimum size of new blocks
+};
+
+// Initializes an empty arena. No memory is allocated until the first allocation.
+void rome_arena_init(struct rome_arena* arena, size_t block_size);
+
+// Allocates size bytes, suitably aligned for any type. Returns NULL if a new block was needed and malloc failed.
+void* rome_arena_alloc(struct rome_arena* arena, size_t size);
+
+// Releases every allocation at once. Pointers obtained before the reset must not be used anymore.
+void rome_arena_reset(struct rome_arena* arena);
+
+// Returns all blocks to the heap. The arena can be reused after calling rome_arena_init again.
+void rome_arena_destroy(struct rome_arena* arena);
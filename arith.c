@@ -0,0 +1,134 @@
+#include "rome.h"
+#include "token.h"
+
+/*
+ * Arithmetic on numerals: both operands are read with the tokenizer, combined with checked integer arithmetic, and the
+ * canonical result is written straight into the caller's buffer. There is no intermediate string and nothing is
+ * allocated.
+ *
+ * The operands are not combined token by token. Validating an operand already walks each of its tokens and adds up
+ * token_value, so its value comes out of that pass for free. Combining the tokens themselves would instead need carries
+ * and borrows between groups (VIII + IV, X - I), a real multiplication for rome_mul, and a pass to make the result
+ * canonical again: more branches than a single integer operation, whose result format_roman then copies out of the
+ * generated table. What is saved over the old parse, add, format is the error message, the allocation, and the
+ * intermediate string.
+ */
+
+enum arith_op {
+    ADD,
+    SUB,
+    MUL,
+};
+
+// Number of elements the array versions process per pass. Each pass keeps four int arrays of this size on the stack.
+enum { CHUNK = 256 };
+
+static enum rome_error_kind write_numeral(const int value, char* const out, const size_t len) {
+    if (value <= 0) {
+        return ROME_ERROR_NO_NUMERAL;
+    }
+    return format_roman(value, out, len) < 0 ? ROME_ERROR_NO_SPACE : ROME_OK;
+}
+
+static bool apply(const enum arith_op op, const int a, const int b, int* const out) {
+    switch (op) {
+        case ADD:
+            return !__builtin_add_overflow(a, b, out);
+        case SUB:
+            return !__builtin_sub_overflow(a, b, out);
+        case MUL:
+            return !__builtin_mul_overflow(a, b, out);
+        default:
+            return false;
+    }
+}
+
+static enum rome_error_kind compute(const enum arith_op op, char const* const a, const size_t alen,
+                                   char const* const b, const size_t blen, char* const out, const size_t outlen) {
+    int x, y, r;
+    struct scan_error err;
+    if (!scan_numeral(a, a + alen, &x, &err) || !scan_numeral(b, b + blen, &y, &err)) {
+        return err.kind;
+    }
+    if (!apply(op, x, y, &r)) {
+        return ROME_ERROR_OVERFLOW;
+    }
+    return write_numeral(r, out, outlen);
+}
+
+static void compute_array(const enum arith_op op, struct rome_span const* const a, struct rome_span const* const b,
+                          const size_t n, char* const out, const size_t stride, enum rome_error_kind* const kinds) {
+    // Parsing and formatting are branchy, the arithmetic is not. Splitting each chunk into three passes leaves the
+    // arithmetic as a tight loop over plain arrays, which the compiler can vectorize.
+    int x[CHUNK], y[CHUNK], r[CHUNK], overflow[CHUNK];
+
+    for (size_t base = 0; base < n; base += CHUNK) {
+        const size_t m = n - base < CHUNK ? n - base : CHUNK;
+
+        for (size_t i = 0; i < m; ++i) {
+            struct rome_span const lhs = a[base + i], rhs = b[base + i];
+            struct scan_error err;
+            x[i] = y[i] = 0;
+            kinds[base + i] = ROME_OK;
+            if (!scan_numeral(lhs.ptr, lhs.ptr + lhs.len, &x[i], &err)
+                || !scan_numeral(rhs.ptr, rhs.ptr + rhs.len, &y[i], &err)) {
+                kinds[base + i] = err.kind;
+            }
+        }
+
+        switch (op) {
+            case ADD:
+                for (size_t i = 0; i < m; ++i) {
+                    overflow[i] = __builtin_add_overflow(x[i], y[i], &r[i]);
+                }
+                break;
+            case SUB:
+                for (size_t i = 0; i < m; ++i) {
+                    overflow[i] = __builtin_sub_overflow(x[i], y[i], &r[i]);
+                }
+                break;
+            case MUL:
+                for (size_t i = 0; i < m; ++i) {
+                    overflow[i] = __builtin_mul_overflow(x[i], y[i], &r[i]);
+                }
+                break;
+        }
+
+        for (size_t i = 0; i < m; ++i) {
+            if (kinds[base + i] != ROME_OK) {
+                continue;
+            }
+            kinds[base + i] = overflow[i] ? ROME_ERROR_OVERFLOW : write_numeral(r[i], out + (base + i) * stride, stride);
+        }
+    }
+}
+
+enum rome_error_kind rome_add(char const* const a, const size_t alen, char const* const b, const size_t blen,
+                              char* const out, const size_t outlen) {
+    return compute(ADD, a, alen, b, blen, out, outlen);
+}
+
+enum rome_error_kind rome_sub(char const* const a, const size_t alen, char const* const b, const size_t blen,
+                              char* const out, const size_t outlen) {
+    return compute(SUB, a, alen, b, blen, out, outlen);
+}
+
+enum rome_error_kind rome_mul(char const* const a, const size_t alen, char const* const b, const size_t blen,
+                              char* const out, const size_t outlen) {
+    return compute(MUL, a, alen, b, blen, out, outlen);
+}
+
+void rome_add_array(struct rome_span const* const a, struct rome_span const* const b, const size_t n,
+                    char* const out, const size_t stride, enum rome_error_kind* const kinds) {
+    compute_array(ADD, a, b, n, out, stride, kinds);
+}
+
+void rome_sub_array(struct rome_span const* const a, struct rome_span const* const b, const size_t n,
+                    char* const out, const size_t stride, enum rome_error_kind* const kinds) {
+    compute_array(SUB, a, b, n, out, stride, kinds);
+}
+
+void rome_mul_array(struct rome_span const* const a, struct rome_span const* const b, const size_t n,
+                    char* const out, const size_t stride, enum rome_error_kind* const kinds) {
+    compute_array(MUL, a, b, n, out, stride, kinds);
+}
@@ -0,0 +1,582 @@
+// Microbenchmarks of the parser's entry points.
+// Each benchmark runs over the same corpus of numerals until enough time has passed, and reports time per numeral.
+// Where the kernel allows it, hardware counters are read around each run with perf_event_open, to tell why one
+// function beats another: IPC, branch misses and L1d misses per numeral. In containers and VMs, counters are often
+// missing or forbidden; then their columns show "-" and the time is still reported.
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "extended.h"
+#include "roman_table.h"
+#include "rome.h"
+
+// Where the build writes the table file (see CMakeLists.txt)
+#ifndef ROME_TABLE_FILE
+#define ROME_TABLE_FILE "roman_table.bin"
+#endif
+
+enum { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, COUNTERS };
+
+static char const* const counter_names[COUNTERS] = {"cycles", "instructions", "branch-misses", "L1d-misses"};
+
+// One file descriptor per counter, or -1 where it is unavailable. They are opened separately rather than as a group,
+// so that a missing counter (L1d misses are often absent in VMs) does not take the others with it.
+struct counters {
+    int fds[COUNTERS];
+};
+
+// Counter values over a run, scaled up if the kernel had to multiplex them. Negative where unavailable.
+struct readings {
+    double values[COUNTERS];
+};
+
+struct corpus {
+    size_t n;
+    struct rome_span* numerals;
+    char const** ptrs;
+    size_t* lens;
+    int32_t* values;   // Value of each numeral (valid corpus only)
+    uint64_t* valid;   // Output of rome_is_valid_batch
+};
+
+static volatile long sink; // Keeps results alive
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void counters_open(struct counters* const c) {
+#ifdef __linux__
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[COUNTERS] = {
+        [CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        [INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        [BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        [L1D_MISSES] = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+
+    int first_errno = 0;
+    char missing[64] = "";
+    for (int i = 0; i < COUNTERS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1; // Allowed without privileges, and the parser never enters the kernel anyway
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        c->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (c->fds[i] < 0) {
+            first_errno = first_errno ? first_errno : errno;
+            strcat(strcat(missing, " "), counter_names[i]);
+        }
+    }
+    if (first_errno != 0) {
+        fprintf(stderr, "note: hardware counters unavailable:%s (perf_event_open: %s%s)\n", missing,
+            strerror(first_errno),
+            first_errno == EACCES || first_errno == EPERM ? ", see /proc/sys/kernel/perf_event_paranoid" : "");
+    }
+#else
+    for (int i = 0; i < COUNTERS; ++i) {
+        c->fds[i] = -1;
+    }
+    fprintf(stderr, "note: hardware counters are only read on Linux\n");
+#endif
+}
+
+static void counters_start(struct counters const* const c) {
+#ifdef __linux__
+    for (int i = 0; i < COUNTERS; ++i) {
+        if (c->fds[i] >= 0) {
+            ioctl(c->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)c;
+#endif
+}
+
+static struct readings counters_stop(struct counters const* const c) {
+    struct readings r;
+    for (int i = 0; i < COUNTERS; ++i) {
+        r.values[i] = -1;
+    }
+#ifdef __linux__
+    for (int i = 0; i < COUNTERS; ++i) {
+        if (c->fds[i] >= 0) {
+            ioctl(c->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < COUNTERS; ++i) {
+        uint64_t data[3]; // Value, time enabled, time running
+        if (c->fds[i] >= 0 && read(c->fds[i], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+            r.values[i] = (double)data[0] * (double)data[1] / (double)data[2];
+        }
+    }
+#else
+    (void)c;
+#endif
+    return r;
+}
+
+static void counters_close(struct counters const* const c) {
+    for (int i = 0; i < COUNTERS; ++i) {
+        if (c->fds[i] >= 0) {
+            close(c->fds[i]);
+        }
+    }
+}
+
+// The benchmarks. Each one processes the whole corpus once.
+
+static void run_parse(struct corpus const* const c, const enum rome_engine engine, const bool format_errors) {
+    struct rome_ctx ctx;
+    rome_ctx_init(&ctx);
+    ctx.engine = engine;
+    ctx.format_errors = format_errors;
+    long sum = 0;
+    for (size_t i = 0; i < c->n; ++i) {
+        const struct result res = rome_parse_n(&ctx, c->numerals[i].ptr, c->numerals[i].len);
+        sum += res.value;
+        free_result(res);
+    }
+    sink = sum;
+}
+
+static void bench_parse_tokenizer(struct corpus const* const c) {
+    run_parse(c, ROME_ENGINE_TOKENIZER, false);
+}
+
+static void bench_parse_dfa(struct corpus const* const c) {
+    run_parse(c, ROME_ENGINE_DFA, false);
+}
+
+static void bench_parse_generated(struct corpus const* const c) {
+    run_parse(c, ROME_ENGINE_GENERATED, false);
+}
+
+static void bench_parse_messages(struct corpus const* const c) {
+    run_parse(c, ROME_ENGINE_TOKENIZER, true);
+}
+
+static void bench_is_valid(struct corpus const* const c) {
+    long sum = 0;
+    for (size_t i = 0; i < c->n; ++i) {
+        sum += rome_is_valid(c->numerals[i].ptr, c->numerals[i].len);
+    }
+    sink = sum;
+}
+
+static void bench_parse_lenient(struct corpus const* const c) {
+    run_parse(c, ROME_ENGINE_LENIENT, false);
+}
+
+static void bench_parse_extended(struct corpus const* const c) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < c->n; ++i) {
+        int64_t value = 0;
+        rome_parse_extended(c->numerals[i].ptr, c->numerals[i].len, &value);
+        sum += value;
+    }
+    sink = (long)sum;
+}
+
+static void bench_is_valid_batch(struct corpus const* const c) {
+    rome_is_valid_batch(c->ptrs, c->lens, c->n, c->valid);
+    sink = (long)c->valid[0];
+}
+
+static void bench_format(struct corpus const* const c) {
+    char buff[32];
+    long sum = 0;
+    for (size_t i = 0; i < c->n; ++i) {
+        sum += format_roman(c->values[i], buff, sizeof(buff));
+    }
+    sink = sum;
+}
+
+// The table file, mapped by main and checked against the compiled-in table
+static struct roman_table mapped_table;
+
+static void bench_format_mapped(struct corpus const* const c) {
+    char buff[32];
+    long sum = 0;
+    for (size_t i = 0; i < c->n; ++i) {
+        const int v = c->values[i];
+        if (v > ROMAN_TABLE_MAX) {
+            sum += format_roman(v, buff, sizeof(buff));
+            continue;
+        }
+        const uint32_t begin = mapped_table.offsets[v];
+        const size_t len = mapped_table.offsets[v + 1] - begin;
+        memcpy(buff, mapped_table.text + begin, len);
+        buff[len] = '\0';
+        sum += (long)len;
+    }
+    sink = sum;
+}
+
+static void bench_compare(struct corpus const* const c) {
+    long sum = 0;
+    for (size_t i = 1; i < c->n; ++i) {
+        sum += rome_compare(c->numerals[i - 1].ptr, c->numerals[i - 1].len, c->numerals[i].ptr, c->numerals[i].len);
+    }
+    sink = sum;
+}
+
+static const struct {
+    char const* name;
+    void (*run)(struct corpus const*);
+    bool valid_only; // Runs over the valid numerals only
+} benchmarks[] = {
+    {"parse/tokenizer", bench_parse_tokenizer, false},
+    {"parse/dfa", bench_parse_dfa, false},
+    {"parse/generated", bench_parse_generated, false},
+    {"parse/messages", bench_parse_messages, false},
+    {"parse/lenient", bench_parse_lenient, false},
+    {"parse/extended", bench_parse_extended, false},
+    {"is_valid", bench_is_valid, false},
+    {"is_valid_batch", bench_is_valid_batch, false},
+    {"format", bench_format, true},
+    {"format/mapped", bench_format_mapped, true},
+    {"compare", bench_compare, true},
+};
+
+static bool corpus_alloc(struct corpus* const c, const size_t n) {
+    c->n = n;
+    c->numerals = malloc(n * sizeof(*c->numerals));
+    c->ptrs = malloc(n * sizeof(*c->ptrs));
+    c->lens = malloc(n * sizeof(*c->lens));
+    c->values = NULL;
+    c->valid = malloc((n + 63) / 64 * sizeof(*c->valid));
+    return c->numerals && c->ptrs && c->lens && c->valid;
+}
+
+static void corpus_set(struct corpus* const c, const size_t i, char const* const ptr, const size_t len) {
+    c->numerals[i] = (struct rome_span) {.ptr = ptr, .len = len};
+    c->ptrs[i] = ptr;
+    c->lens[i] = len;
+}
+
+// Builds n numerals of random values, and damages a fraction of them
+static bool corpus_build(struct corpus* const c, const size_t n, const double invalid, const unsigned seed) {
+    char* const text = malloc(n * 16);
+    if (!text || !corpus_alloc(c, n)) {
+        return false;
+    }
+
+    srand(seed);
+    char* it = text;
+    for (size_t i = 0; i < n; ++i) {
+        const int len = format_roman(rand() % 3999 + 1, it, 16);
+        if ((double)rand() / RAND_MAX < invalid) {
+            // Mostly bad repeats, pairs and sequences, and a few stray characters. Some damage leaves a valid numeral.
+            static char const damage[] = "IVXQ";
+            it[rand() % len] = damage[rand() % 4];
+        }
+        corpus_set(c, i, it, (size_t)len);
+        it += len + 1;
+    }
+    return true;
+}
+
+// Reads one numeral per line from a file, such as a sample of production traffic
+static bool corpus_load(struct corpus* const c, char const* const path) {
+    FILE* const f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    size_t size = 0, capacity = 1 << 16;
+    char* text = malloc(capacity);
+    size_t got;
+    while (text && (got = fread(text + size, 1, capacity - size, f)) > 0) {
+        size += got;
+        if (size == capacity) {
+            capacity *= 2;
+            char* const grown = realloc(text, capacity);
+            if (!grown) {
+                free(text);
+            }
+            text = grown;
+        }
+    }
+    const bool read_error = ferror(f);
+    fclose(f);
+    if (!text || read_error) {
+        free(text);
+        return false;
+    }
+
+    size_t lines = 0;
+    for (size_t i = 0; i < size; ++i) {
+        lines += text[i] == '\n';
+    }
+    lines += size > 0 && text[size - 1] != '\n';
+    if (!corpus_alloc(c, lines)) {
+        return false;
+    }
+
+    char const* it = text;
+    char const* const end = text + size;
+    for (size_t i = 0; i < lines; ++i) {
+        char const* eol = memchr(it, '\n', (size_t)(end - it));
+        eol = eol ? eol : end;
+        size_t len = (size_t)(eol - it);
+        len -= len > 0 && it[len - 1] == '\r';
+        corpus_set(c, i, it, len);
+        it = eol + 1;
+    }
+    return true;
+}
+
+// Reads the ns/num column saved by --save from another build
+static bool baseline_load(char const* const path, double ns[]) {
+    FILE* const f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char name[64];
+    double value;
+    while (fscanf(f, "%63s %lf", name, &value) == 2) {
+        for (size_t b = 0; b < sizeof(benchmarks) / sizeof(*benchmarks); ++b) {
+            if (strcmp(name, benchmarks[b].name) == 0) {
+                ns[b] = value;
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Keeps the valid numerals of src, for the benchmarks that need them
+static bool corpus_valid(struct corpus* const dst, struct corpus const* const src) {
+    *dst = *src;
+    dst->numerals = malloc(src->n * sizeof(*dst->numerals));
+    dst->values = malloc(src->n * sizeof(*dst->values));
+    if (!dst->numerals || !dst->values) {
+        return false;
+    }
+    struct rome_ctx ctx;
+    rome_ctx_init(&ctx);
+    ctx.format_errors = false;
+    dst->n = 0;
+    for (size_t i = 0; i < src->n; ++i) {
+        const struct result res = rome_parse_n(&ctx, src->numerals[i].ptr, src->numerals[i].len);
+        if (res.error == NULL) {
+            dst->numerals[dst->n] = src->numerals[i];
+            dst->values[dst->n] = res.value;
+            ++dst->n;
+        }
+    }
+    return true;
+}
+
+static void usage(FILE* const f, char const* const argv0) {
+    fprintf(f,
+        "usage: %s [options] [NAME]...\n"
+        "Runs the benchmarks whose names contain one of the NAMEs (default: all) and reports, per numeral, the time\n"
+        "and the hardware counters the kernel allows.\n"
+        "\n"
+        "  --numerals N        Size of the corpus (default: 65536)\n"
+        "  --invalid FRACTION  Fraction of damaged, mostly invalid, numerals (default: 0.1)\n"
+        "  --seconds S         Shortest time to run each benchmark for (default: 0.5)\n"
+        "  --corpus FILE       Read the numerals from FILE, one per line, instead of making them up\n"
+        "  --save FILE         Write the time per numeral of each benchmark to FILE\n"
+        "  --baseline FILE     Compare with the times saved by another build, as its time over ours\n"
+        "  --table FILE        Table file to map for format/mapped (default: the one this build wrote)\n"
+        "  --help              Show this message\n",
+        argv0);
+}
+
+int main(const int argc, char* const* const argv) {
+    enum { OPT_NUMERALS = 256, OPT_INVALID, OPT_SECONDS, OPT_CORPUS, OPT_SAVE, OPT_BASELINE, OPT_TABLE, OPT_HELP };
+    static const struct option options[] = {
+        {"numerals", required_argument, NULL, OPT_NUMERALS},
+        {"invalid", required_argument, NULL, OPT_INVALID},
+        {"seconds", required_argument, NULL, OPT_SECONDS},
+        {"corpus", required_argument, NULL, OPT_CORPUS},
+        {"save", required_argument, NULL, OPT_SAVE},
+        {"baseline", required_argument, NULL, OPT_BASELINE},
+        {"table", required_argument, NULL, OPT_TABLE},
+        {"help", no_argument, NULL, OPT_HELP},
+        {NULL, 0, NULL, 0},
+    };
+
+    size_t n = 65536;
+    double invalid = 0.1;
+    double seconds = 0.5;
+    char const* corpus_path = NULL;
+    char const* save_path = NULL;
+    char const* baseline_path = NULL;
+    char const* table_path = ROME_TABLE_FILE;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        char* end;
+        switch (opt) {
+            case OPT_NUMERALS:
+                n = strtoul(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || n < 2) {
+                    fprintf(stderr, "%s: expected at least 2 numerals: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_INVALID:
+                invalid = strtod(optarg, &end);
+                if (end == optarg || *end != '\0' || invalid < 0 || invalid > 1) {
+                    fprintf(stderr, "%s: expected a fraction: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_SECONDS:
+                seconds = strtod(optarg, &end);
+                if (end == optarg || *end != '\0' || seconds <= 0) {
+                    fprintf(stderr, "%s: expected a positive number of seconds: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_CORPUS:
+                corpus_path = optarg;
+                break;
+            case OPT_SAVE:
+                save_path = optarg;
+                break;
+            case OPT_BASELINE:
+                baseline_path = optarg;
+                break;
+            case OPT_TABLE:
+                table_path = optarg;
+                break;
+            case OPT_HELP:
+                usage(stdout, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    struct corpus all, valid;
+    const bool loaded = corpus_path ? corpus_load(&all, corpus_path) : corpus_build(&all, n, invalid, 1);
+    if (!loaded || !corpus_valid(&valid, &all)) {
+        perror(corpus_path ? corpus_path : argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (all.n < 2 || valid.n < 2) {
+        fprintf(stderr, "%s: the corpus needs at least 2 valid numerals\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The file must hold the very table format_roman uses, or format/mapped would time something else
+    if (!roman_table_map(&mapped_table, table_path)) {
+        fprintf(stderr, "%s: %s is not a table file\n", argv[0], table_path);
+        return EXIT_FAILURE;
+    }
+    if (memcmp(mapped_table.offsets, roman_table_offsets, sizeof(roman_table_offsets)) != 0
+        || memcmp(mapped_table.text, roman_table_text, roman_table_offsets[ROMAN_TABLE_MAX + 1]) != 0) {
+        fprintf(stderr, "%s: %s does not match the compiled-in table\n", argv[0], table_path);
+        return EXIT_FAILURE;
+    }
+
+    double baseline[sizeof(benchmarks) / sizeof(*benchmarks)];
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(*benchmarks); ++b) {
+        baseline[b] = -1;
+    }
+    if (baseline_path && !baseline_load(baseline_path, baseline)) {
+        perror(baseline_path);
+        return EXIT_FAILURE;
+    }
+    FILE* const save = save_path ? fopen(save_path, "w") : NULL;
+    if (save_path && !save) {
+        perror(save_path);
+        return EXIT_FAILURE;
+    }
+
+    struct counters counters;
+    counters_open(&counters);
+
+    printf("%-16s %9s %11s %7s %12s %12s%s\n", "benchmark", "ns/num", "cycles/num", "IPC", "br-miss/num",
+        "L1d-miss/num", baseline_path ? "  speedup" : "");
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(*benchmarks); ++b) {
+        bool selected = optind == argc;
+        for (int i = optind; i < argc && !selected; ++i) {
+            selected = strstr(benchmarks[b].name, argv[i]) != NULL;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        struct corpus const* const c = benchmarks[b].valid_only ? &valid : &all;
+        benchmarks[b].run(c); // Warm up caches and branch predictors
+
+        size_t runs = 0;
+        const double start = now();
+        double elapsed;
+        counters_start(&counters);
+        do {
+            benchmarks[b].run(c);
+            ++runs;
+        } while ((elapsed = now() - start) < seconds);
+        const struct readings r = counters_stop(&counters);
+
+        // Per numeral, or "-" where a counter is unavailable
+        const double numerals = (double)runs * (double)c->n;
+        char columns[COUNTERS][16];
+        const double per[COUNTERS] = {
+            r.values[CYCLES] / numerals,
+            r.values[CYCLES] > 0 && r.values[INSTRUCTIONS] >= 0 ? r.values[INSTRUCTIONS] / r.values[CYCLES] : -1,
+            r.values[BRANCH_MISSES] / numerals,
+            r.values[L1D_MISSES] / numerals,
+        };
+        const int precision[COUNTERS] = {1, 2, 3, 3};
+        for (int i = 0; i < COUNTERS; ++i) {
+            if (per[i] >= 0) {
+                snprintf(columns[i], sizeof(columns[i]), "%.*f", precision[i], per[i]);
+            } else {
+                strcpy(columns[i], "-");
+            }
+        }
+        const double ns = elapsed * 1e9 / numerals;
+        printf("%-16s %9.2f %11s %7s %12s %12s", benchmarks[b].name, ns, columns[CYCLES], columns[INSTRUCTIONS],
+            columns[BRANCH_MISSES], columns[L1D_MISSES]);
+        if (baseline[b] > 0) {
+            printf("  %6.3fx", baseline[b] / ns);
+        } else if (baseline_path) {
+            printf("  %7s", "-");
+        }
+        printf("\n");
+        if (save) {
+            fprintf(save, "%s %.4f\n", benchmarks[b].name, ns);
+        }
+    }
+
+    counters_close(&counters);
+    roman_table_unmap(&mapped_table);
+    if (save && fclose(save) != 0) {
+        perror(save_path);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
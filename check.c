@@ -0,0 +1,475 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfa.h"
+#include "extended.h"
+#include "generated.h"
+#include "lenient.h"
+#include "roman_table.h"
+#include "stream.h"
+#include "token.h"
+
+/*
+ * Differential checks of the parsers against each other and against what they document, run by ctest with one test
+ * per check (see CMakeLists.txt):
+ *     generated   The parser generated from rome.grammar (see gen_parser.c) against the tokenizer, unless the grammar
+ *                 says it describes another dialect: on every string of up to CHECK_LENGTH bytes over the digits and a
+ *                 stray letter, and on every canonical numeral.
+ *     stream      The push parser (see stream.c) against scan_numeral, on every numeral of every string of up to
+ *                 STREAM_CHECK_LENGTH bytes over the digits, a stray letter and a delimiter, fed in two chunks split at
+ *                 every byte boundary, and fed one byte at a time.
+ *     dialects    The tables of every built-in dialect (see dfa.c) against the spellings the dialect documents, with
+ *                 the value lenient_numeral reads from them: they must accept every spelling of every value the
+ *                 dialect can write, and nothing else among the strings of up to CHECK_LENGTH bytes over its alphabet.
+ *     extended    rome_parse_extended reads back what rome_format_extended writes, in every notation, rejects second
+ *                 spellings (_I for M, mixed apostrophus marks), and agrees with the tables of the extended dialect on
+ *                 every string of up to CHECK_LENGTH bytes over its alphabet with single overlines.
+ *
+ * Usage: rome_check <check>
+ */
+
+enum { CHECK_LENGTH = 7, STREAM_CHECK_LENGTH = 6, MAX_DIALECT_SPELLING = 48 };
+
+static int errors;
+
+// Compares generated_parse with scan_numeral on the len bytes at str
+static void check_generated(char const* const str, const int len) {
+    int expected = 0, got = 0;
+    struct scan_error err;
+    const bool valid = scan_numeral(str, str + len, &expected, &err);
+    const bool generated = generated_parse(str, (size_t)len, &got);
+    if (generated == valid && (!valid || got == expected)) {
+        return;
+    }
+    if (errors < 10) {
+        char a[16] = "invalid", b[16] = "invalid";
+        if (generated) {
+            snprintf(a, sizeof(a), "%d", got);
+        }
+        if (valid) {
+            snprintf(b, sizeof(b), "%d", expected);
+        }
+        fprintf(stderr, "rome_check: the generated parser reads '%.*s' as %s, the tokenizer as %s\n", len, str, a, b);
+    }
+    ++errors;
+}
+
+// Checks every string over the digits and a stray letter that extends the len bytes in buff
+static void check_strings(char* const buff, const int len) {
+    static char const alphabet[] = "IVXLCDMa";
+    check_generated(buff, len);
+    if (len == CHECK_LENGTH) {
+        return;
+    }
+    for (char const* c = alphabet; *c != '\0'; ++c) {
+        buff[len] = *c;
+        check_strings(buff, len + 1);
+    }
+}
+
+static void run_generated(void) {
+    if (!generated_matches_tokenizer) {
+        printf("rome.grammar describes another dialect: nothing to check\n");
+        return;
+    }
+    char check[CHECK_LENGTH];
+    check_strings(check, 0);
+    for (int v = 1; v <= ROMAN_TABLE_MAX; ++v) {
+        const uint32_t begin = roman_table_offsets[v];
+        check_generated(roman_table_text + begin, (int)(roman_table_offsets[v + 1] - begin));
+    }
+}
+
+// Events a stream reported while checking it
+struct stream_events {
+    struct rome_event events[STREAM_CHECK_LENGTH];
+    int count;
+};
+
+static void collect_event(void* const user, struct rome_event const* const event) {
+    struct stream_events* const e = user;
+    if (e->count < STREAM_CHECK_LENGTH) {
+        e->events[e->count] = *event;
+    }
+    ++e->count;
+}
+
+// Feeds the len bytes at str to a push parser in chunks of chunk bytes, or in two chunks split at split if chunk is 0,
+// and compares its events with what scan_numeral reads from each numeral
+static void check_stream_split(char const* const str, const int len, const int split, const int chunk) {
+    struct stream_events got = {.count = 0};
+    struct rome_stream stream;
+    rome_stream_init(&stream, collect_event, &got);
+    if (chunk == 0) {
+        rome_stream_feed(&stream, str, (size_t)split);
+        rome_stream_feed(&stream, str + split, (size_t)(len - split));
+    } else {
+        for (int i = 0; i < len; i += chunk) {
+            rome_stream_feed(&stream, str + i, (size_t)(len - i < chunk ? len - i : chunk));
+        }
+    }
+    rome_stream_finish(&stream);
+
+    int count = 0;
+    bool same = true;
+    for (int begin = 0; begin < len;) {
+        if (str[begin] == ' ') {
+            ++begin;
+            continue;
+        }
+        int end = begin;
+        while (end < len && str[end] != ' ') {
+            ++end;
+        }
+
+        int value = 0;
+        struct scan_error err = {.kind = ROME_OK};
+        const bool valid = scan_numeral(str + begin, str + end, &value, &err);
+        struct rome_event const* const e = &got.events[count];
+        same = same && count < got.count && e->kind == (valid ? ROME_OK : err.kind) && (!valid || e->value == value)
+            && e->offset == (uint64_t)begin && e->length == (uint64_t)(end - begin)
+            && (valid || e->error_offset == (uint64_t)(begin + err.offset));
+        ++count;
+        begin = end;
+    }
+    if (same && count == got.count) {
+        return;
+    }
+    if (errors < 10) {
+        fprintf(stderr, "rome_check: the push parser disagrees with the tokenizer on '%.*s' split at %d\n", len, str,
+                chunk == 0 ? split : chunk);
+    }
+    ++errors;
+}
+
+// Checks the push parser on every string over the digits, a stray letter and a delimiter that extends the len bytes
+// in buff
+static void check_stream(char* const buff, const int len) {
+    static char const alphabet[] = "IVXLCDMa ";
+    for (int split = 0; split <= len; ++split) {
+        check_stream_split(buff, len, split, 0);
+    }
+    check_stream_split(buff, len, 0, 1);
+    if (len == STREAM_CHECK_LENGTH) {
+        return;
+    }
+    for (char const* c = alphabet; *c != '\0'; ++c) {
+        buff[len] = *c;
+        check_stream(buff, len + 1);
+    }
+}
+
+static void run_stream(void) {
+    char check[STREAM_CHECK_LENGTH];
+    check_stream(check, 0);
+}
+
+// What a built-in dialect is documented to accept, written out independently of the rules dfa.c compiles
+struct dialect_check {
+    enum rome_dialect dialect;
+    char const* name;
+    char const* alphabet; // Its digits and a byte it rejects
+    enum rome_form fours, nines;
+    bool lowercase;
+    bool vinculum;        // Thousands from 4000 on are overlined, up to _M_M_M_C_M_X_C_I_X
+};
+
+static const struct dialect_check dialect_checks[] = {
+    {ROME_DIALECT_STRICT, "strict", "IVXLCDMi", ROME_FORM_SUBTRACTIVE, ROME_FORM_SUBTRACTIVE, false, false},
+    {ROME_DIALECT_CLOCK, "clock", "IVXLCDMa", ROME_FORM_ADDITIVE, ROME_FORM_SUBTRACTIVE, false, false},
+    {ROME_DIALECT_MEDIEVAL, "medieval", "IVXLCDMa", ROME_FORM_EITHER, ROME_FORM_EITHER, false, false},
+    {ROME_DIALECT_LOWERCASE, "lowercase", "ivxlcdmI", ROME_FORM_SUBTRACTIVE, ROME_FORM_SUBTRACTIVE, true, false},
+    {ROME_DIALECT_EXTENDED, "extended", "IVXLCDM_", ROME_FORM_SUBTRACTIVE, ROME_FORM_SUBTRACTIVE, false, true},
+};
+
+// Largest value whose spellings are checked. Vinculum dialects stop there; the others repeat M as much as they need.
+static int dialect_max(struct dialect_check const* const d) {
+    return d->vinculum ? 3999999 : ROMAN_TABLE_MAX;
+}
+
+// Writes the group of a decimal digit (0..9) to out, with the one, five and ten letters given. Returns the end.
+static char* spell_group(char* out, const int digit, char const* const letters, const bool additive,
+                         const bool lowercase, const bool overline) {
+    static char const* const patterns[10] = {"", "o", "oo", "ooo", "of", "f", "fo", "foo", "fooo", "ot"};
+    char const* pattern = patterns[digit];
+    if (additive) {
+        pattern = digit == 4 ? "oooo" : "foooo";
+    }
+    for (char const* it = pattern; *it != '\0'; ++it) {
+        const char letter = letters[*it == 'o' ? 0 : *it == 'f' ? 1 : 2];
+        if (overline) {
+            *out++ = '_';
+        }
+        *out++ = lowercase ? (char)tolower((unsigned char)letter) : letter;
+    }
+    return out;
+}
+
+// Writes the thousands, hundreds, tens and units of value (below 10,000) to out. Bit i of forms picks the additive
+// spelling of the i-th group from the right, where the dialect allows both. Returns the end, or NULL if forms picks a
+// spelling the dialect does not allow or a group that has a single spelling.
+static char* spell_digits(char* out, const int value, struct dialect_check const* const d, const unsigned forms,
+                          const bool overline) {
+    static char const* const letters[3] = {"CDM", "XLC", "IVX"};
+    const int digits[3] = {value / 100 % 10, value / 10 % 10, value % 10};
+    for (int i = 0; i < value / 1000; ++i) {
+        if (overline) {
+            *out++ = '_';
+        }
+        *out++ = d->lowercase ? 'm' : 'M';
+    }
+    for (int g = 0; g < 3; ++g) {
+        const bool picked = (forms >> (2 - g)) & 1;
+        const enum rome_form form = digits[g] == 4 ? d->fours : d->nines;
+        bool additive = false;
+        if (digits[g] == 4 || digits[g] == 9) {
+            if (form == ROME_FORM_EITHER) {
+                additive = picked;
+            } else if (picked) {
+                return NULL;
+            } else {
+                additive = form == ROME_FORM_ADDITIVE;
+            }
+        } else if (picked) {
+            return NULL;
+        }
+        out = spell_group(out, digits[g], letters[g], additive, d->lowercase, overline);
+    }
+    return out;
+}
+
+// Writes every spelling of value in the dialect to spellings, null-terminated. Returns how many there are.
+static int spell_dialect(struct dialect_check const* const d, const int value,
+                         char spellings[8][MAX_DIALECT_SPELLING]) {
+    int n = 0;
+    for (unsigned forms = 0; forms < 8; ++forms) {
+        char* out = spellings[n];
+        if (d->vinculum && value >= 4000) {
+            out = spell_digits(out, value / 1000, d, forms, true);
+            out = out == NULL ? NULL : spell_digits(out, value % 1000, d, forms, false);
+        } else {
+            out = spell_digits(out, value, d, forms, false);
+        }
+        if (out != NULL) {
+            *out = '\0';
+            ++n;
+        }
+    }
+    return n;
+}
+
+// Reports that the tables of a dialect read the len bytes at str wrong
+static void dialect_error(struct dialect_check const* const d, char const* const str, const int len,
+                          char const* const what) {
+    if (errors < 10) {
+        fprintf(stderr, "rome_check: the %s dialect %s '%.*s'\n", d->name, what, len, str);
+    }
+    ++errors;
+}
+
+// Checks the tables of a dialect on the len bytes at str: if they accept them, they must be a spelling of the value
+// they read, and lenient_numeral must read the same value
+static void check_dialect(struct dialect_check const* const d, struct rome_dfa const* const dfa,
+                          char const* const str, const int len) {
+    int value = 0;
+    if (!dfa_parse(dfa, str, (size_t)len, &value)) {
+        return;
+    }
+    if (value < 1 || (d->vinculum && value > dialect_max(d))) {
+        dialect_error(d, str, len, "reads a value out of range from");
+        return;
+    }
+
+    char spellings[8][MAX_DIALECT_SPELLING];
+    const int n = spell_dialect(d, value, spellings);
+    bool found = false;
+    for (int i = 0; i < n && !found; ++i) {
+        found = (int)strlen(spellings[i]) == len && memcmp(spellings[i], str, (size_t)len) == 0;
+    }
+    if (!found) {
+        dialect_error(d, str, len, "accepts a spelling it does not document:");
+        return;
+    }
+
+    if (!d->vinculum) {
+        char upper[CHECK_LENGTH];
+        for (int i = 0; i < len; ++i) {
+            upper[i] = (char)toupper((unsigned char)str[i]);
+        }
+        int expected = 0;
+        struct scan_error err;
+        if (!lenient_numeral(upper, upper + len, &expected, &err) || expected != value) {
+            dialect_error(d, str, len, "disagrees with lenient_numeral on");
+        }
+    }
+}
+
+// Checks every string over the alphabet of a dialect that extends the len bytes in buff
+static void check_dialect_strings(struct dialect_check const* const d, struct rome_dfa const* const dfa,
+                                  char* const buff, const int len) {
+    check_dialect(d, dfa, buff, len);
+    if (len == CHECK_LENGTH) {
+        return;
+    }
+    for (char const* c = d->alphabet; *c != '\0'; ++c) {
+        buff[len] = *c;
+        check_dialect_strings(d, dfa, buff, len + 1);
+    }
+}
+
+// Checks that the tables of a dialect accept every spelling of every value it can write, with that value
+static void check_dialect_spellings(struct dialect_check const* const d, struct rome_dfa const* const dfa) {
+    for (int v = 1; v <= dialect_max(d); ++v) {
+        char spellings[8][MAX_DIALECT_SPELLING];
+        const int n = spell_dialect(d, v, spellings);
+        for (int i = 0; i < n; ++i) {
+            const int len = (int)strlen(spellings[i]);
+            int value = 0;
+            if (!dfa_parse(dfa, spellings[i], (size_t)len, &value)) {
+                dialect_error(d, spellings[i], len, "rejects");
+            } else if (value != v) {
+                dialect_error(d, spellings[i], len, "reads a wrong value from");
+            }
+        }
+    }
+}
+
+static void run_dialects(void) {
+    for (size_t i = 0; i < sizeof(dialect_checks) / sizeof(dialect_checks[0]); ++i) {
+        struct dialect_check const* const d = &dialect_checks[i];
+        struct rome_dfa const* const dfa = dfa_dialect(d->dialect);
+        char check[CHECK_LENGTH];
+        check_dialect_strings(d, dfa, check, 0);
+        check_dialect_spellings(d, dfa);
+    }
+}
+
+// Reports that rome_parse_extended reads the len bytes at str as got (a value, or why it rejected them)
+static void extended_error(char const* const str, const size_t len, const enum rome_error_kind kind, const int64_t got,
+                           char const* const expected) {
+    if (errors < 10) {
+        char a[32] = "invalid";
+        if (kind == ROME_OK) {
+            snprintf(a, sizeof(a), "%lld", (long long)got);
+        }
+        fprintf(stderr, "rome_check: rome_parse_extended reads '%.*s' as %s, expected %s\n", (int)len, str, a, expected);
+    }
+    ++errors;
+}
+
+// Formats value in every notation and parses it back
+static void check_extended_value(const int64_t value) {
+    static const enum rome_notation notations[] = {ROME_NOTATION_VINCULUM, ROME_NOTATION_VINCULUM_ASCII,
+                                                   ROME_NOTATION_APOSTROPHUS, ROME_NOTATION_APOSTROPHUS_ASCII};
+    for (size_t i = 0; i < sizeof(notations) / sizeof(notations[0]); ++i) {
+        char numeral[ROME_EXTENDED_MAX];
+        const int len = rome_format_extended(value, notations[i], numeral, sizeof(numeral));
+        int64_t got = 0;
+        const enum rome_error_kind kind = len < 0 ? ROME_ERROR_OTHER : rome_parse_extended(numeral, (size_t)len, &got);
+        if (kind != ROME_OK || got != value) {
+            char expected[32];
+            snprintf(expected, sizeof(expected), "%lld", (long long)value);
+            extended_error(numeral, len < 0 ? 0 : (size_t)len, kind, got, expected);
+        }
+    }
+}
+
+// Compares rome_parse_extended with the tables of the extended dialect on the len bytes at str
+static void check_extended_dialect(struct rome_dfa const* const dfa, char const* const str, const int len) {
+    for (int i = 1; i < len; ++i) {
+        if (str[i - 1] == '_' && str[i] == '_') {
+            return; // Stacked overlines are beyond the dialect
+        }
+    }
+    int expected = 0;
+    int64_t got = 0;
+    const bool valid = dfa_parse(dfa, str, (size_t)len, &expected);
+    const enum rome_error_kind kind = rome_parse_extended(str, (size_t)len, &got);
+    if ((kind == ROME_OK) != valid || (valid && got != expected)) {
+        char b[32] = "invalid";
+        if (valid) {
+            snprintf(b, sizeof(b), "%d as the extended dialect does", expected);
+        }
+        extended_error(str, (size_t)len, kind, got, b);
+    }
+}
+
+static void check_extended_strings(struct rome_dfa const* const dfa, char* const buff, const int len) {
+    static char const alphabet[] = "IVXLCDM_";
+    check_extended_dialect(dfa, buff, len);
+    if (len == CHECK_LENGTH) {
+        return;
+    }
+    for (char const* c = alphabet; *c != '\0'; ++c) {
+        buff[len] = *c;
+        check_extended_strings(dfa, buff, len + 1);
+    }
+}
+
+static void run_extended(void) {
+    for (int64_t v = 1; v <= 100000; ++v) {
+        check_extended_value(v);
+    }
+    for (int64_t v = 100000; v <= 4000000; v += 997) {
+        check_extended_value(v);
+    }
+    // Every digit of larger values, up to the largest that fits
+    for (int64_t scale = 1000000; scale <= INT64_MAX / 10; scale *= 10) {
+        for (int64_t d = 1; d <= 9; ++d) {
+            check_extended_value(d * scale + 1999);
+            check_extended_value(d * scale * 10 - 1);
+        }
+    }
+    check_extended_value(INT64_MAX);
+
+    // Second spellings of a digit, and apostrophus glyphs with mixed marks
+    static char const* const rejected[] = {
+        "_I", "_IV", "_I_I", "_I_I_I", "_XM", "M_V", "C_I", "_C__I", "_I__V", "I\xCC\x85", "I\xCC\x85V",
+        "I\xCC\x85\xCC\x85", "CI)", "(I\xE2\x86\x83", "CCI)",
+    };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); ++i) {
+        int64_t got = 0;
+        const size_t len = strlen(rejected[i]);
+        const enum rome_error_kind kind = rome_parse_extended(rejected[i], len, &got);
+        if (kind == ROME_OK) {
+            extended_error(rejected[i], len, kind, got, "invalid");
+        }
+    }
+
+    char check[CHECK_LENGTH];
+    check_extended_strings(dfa_dialect(ROME_DIALECT_EXTENDED), check, 0);
+}
+
+static const struct {
+    char const* name;
+    void (*run)(void);
+} checks[] = {
+    {"generated", run_generated},
+    {"stream", run_stream},
+    {"dialects", run_dialects},
+    {"extended", run_extended},
+};
+
+int main(const int argc, char const* const* const argv) {
+    const size_t n = sizeof(checks) / sizeof(checks[0]);
+    for (size_t i = 0; argc == 2 && i < n; ++i) {
+        if (strcmp(argv[1], checks[i].name) == 0) {
+            checks[i].run();
+            if (errors != 0) {
+                fprintf(stderr, "rome_check: %s: %d failures\n", checks[i].name, errors);
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+    }
+
+    fprintf(stderr, "usage: %s <check>\nchecks:", argv[0]);
+    for (size_t i = 0; i < n; ++i) {
+        fprintf(stderr, " %s", checks[i].name);
+    }
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+#include "columns.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum { ALIGNMENT = 64, HEADER_SIZE = 64 };
+
+static size_t align_up(const size_t x) {
+    return (x + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+bool rome_columns_init(struct rome_columns* const columns, const enum rome_value_width width, const size_t capacity) {
+    *columns = (struct rome_columns) {
+        .width = width,
+        .rows = 0,
+        .capacity = capacity,
+        .values = aligned_alloc(ALIGNMENT, align_up(capacity * (size_t)width)),
+        .validity = aligned_alloc(ALIGNMENT, align_up((capacity + 7) / 8)),
+        .errors = aligned_alloc(ALIGNMENT, align_up(capacity)),
+    };
+
+    if (columns->values == NULL || columns->validity == NULL || columns->errors == NULL) {
+        rome_columns_destroy(columns);
+        return false;
+    }
+
+    rome_columns_clear(columns);
+    return true;
+}
+
+void rome_columns_push(struct rome_columns* const columns, const int value, const enum rome_error_kind kind) {
+    const size_t i = columns->rows++;
+    const bool valid = kind == ROME_OK;
+
+    // Values are stored in host order, which write converts if the host is not little-endian
+    if (columns->width == ROME_INT32) {
+        ((int32_t*)columns->values)[i] = valid ? value : 0;
+    } else {
+        ((int64_t*)columns->values)[i] = valid ? value : 0;
+    }
+    columns->validity[i / 8] |= (uint8_t)(valid << (i % 8));
+    columns->errors[i] = (uint8_t)kind;
+}
+
+bool rome_columns_full(struct rome_columns const* const columns) {
+    return columns->rows == columns->capacity;
+}
+
+static void put_u32(unsigned char* const out, const uint32_t x) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = (unsigned char)(x >> (8 * i));
+    }
+}
+
+static void put_u64(unsigned char* const out, const uint64_t x) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = (unsigned char)(x >> (8 * i));
+    }
+}
+
+static bool write_zeros(const size_t n, FILE* const f) {
+    static const unsigned char zeros[ALIGNMENT] = {0};
+    return fwrite(zeros, 1, n, f) == n;
+}
+
+// Writes n bytes of buff followed by zeros up to the next 64-byte boundary
+static bool write_padded(void const* const buff, const size_t n, FILE* const f) {
+    return fwrite(buff, 1, n, f) == n && write_zeros(align_up(n) - n, f);
+}
+
+// Writes the values one by one in little-endian order, for big-endian hosts
+static bool write_values_swapped(struct rome_columns const* const columns, FILE* const f) {
+    unsigned char buff[8];
+    for (size_t i = 0; i < columns->rows; ++i) {
+        if (columns->width == ROME_INT32) {
+            put_u32(buff, (uint32_t)((int32_t*)columns->values)[i]);
+        } else {
+            put_u64(buff, (uint64_t)((int64_t*)columns->values)[i]);
+        }
+        if (fwrite(buff, 1, (size_t)columns->width, f) != (size_t)columns->width) {
+            return false;
+        }
+    }
+    const size_t n = columns->rows * (size_t)columns->width;
+    return write_zeros(align_up(n) - n, f);
+}
+
+bool rome_columns_write(struct rome_columns const* const columns, FILE* const f) {
+    const size_t values_size = align_up(columns->rows * (size_t)columns->width);
+    const size_t validity_size = align_up((columns->rows + 7) / 8);
+    const size_t errors_size = align_up(columns->rows);
+
+    unsigned char header[HEADER_SIZE] = {0};
+    memcpy(header, ROME_COLUMNS_MAGIC, 8);
+    put_u32(header + 8, (uint32_t)columns->width);
+    put_u64(header + 16, columns->rows);
+    put_u64(header + 24, HEADER_SIZE);
+    put_u64(header + 32, HEADER_SIZE + values_size);
+    put_u64(header + 40, HEADER_SIZE + values_size + validity_size);
+    put_u64(header + 48, HEADER_SIZE + values_size + validity_size + errors_size);
+
+    if (fwrite(header, 1, sizeof(header), f) != sizeof(header)) {
+        return false;
+    }
+
+    const bool little_endian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+    const bool values_written = little_endian
+        ? write_padded(columns->values, columns->rows * (size_t)columns->width, f)
+        : write_values_swapped(columns, f);
+
+    return values_written
+        && write_padded(columns->validity, (columns->rows + 7) / 8, f)
+        && write_padded(columns->errors, columns->rows, f);
+}
+
+void rome_columns_clear(struct rome_columns* const columns) {
+    columns->rows = 0;
+    memset(columns->validity, 0, (columns->capacity + 7) / 8);
+}
+
+void rome_columns_destroy(struct rome_columns* const columns) {
+    free(columns->values);
+    free(columns->validity);
+    free(columns->errors);
+    *columns = (struct rome_columns) {0};
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "result.h"
+
+// Width of the values in a columnar batch
+enum rome_value_width {
+    ROME_INT32 = 4,
+    ROME_INT64 = 8,
+};
+
+// Conversion results laid out as columns, to be written in binary and mapped downstream without parsing any text.
+//
+// A batch is written as a 64-byte header followed by three buffers, each starting at a multiple of 64 bytes:
+//     offset  0: char     magic[8]           ROME_COLUMNS_MAGIC
+//     offset  8: uint32_t width              4 (int32 values) or 8 (int64 values)
+//     offset 12: uint32_t reserved           0
+//     offset 16: uint64_t rows
+//     offset 24: uint64_t values_offset      From the start of the batch
+//     offset 32: uint64_t validity_offset
+//     offset 40: uint64_t errors_offset
+//     offset 48: uint64_t size               Size of the whole batch, so batches can be skipped or concatenated
+//     offset 56: uint64_t reserved           0
+// All integers are little-endian. Values are zero for invalid rows. The validity bitmap has bit i%8 of byte i/8 set if
+// row i is valid. Errors hold one enum rome_error_kind per row, as a byte.
+// The buffers follow Arrow's physical layout (64-byte alignment, LSB-first validity, zero padding), so a reader can
+// hand them to Arrow as an Int32/Int64 array and a UInt8 array without copying.
+struct rome_columns {
+    enum rome_value_width width;
+    size_t rows;        // Rows pushed since the last clear
+    size_t capacity;    // Rows the batch can hold
+    void* values;       // int32_t or int64_t, depending on width
+    uint8_t* validity;
+    uint8_t* errors;
+};
+
+#define ROME_COLUMNS_MAGIC "ROMECOL1"
+
+// Allocates a batch for up to capacity rows (at least one). This is the only allocation. Returns false if it fails.
+bool rome_columns_init(struct rome_columns* columns, enum rome_value_width width, size_t capacity);
+
+// Appends a row. The batch must not be full.
+void rome_columns_push(struct rome_columns* columns, int value, enum rome_error_kind kind);
+
+// Whether the batch is full and must be written before pushing more rows.
+bool rome_columns_full(struct rome_columns const* columns);
+
+// Writes the batch to f. Returns false on write errors.
+bool rome_columns_write(struct rome_columns const* columns, FILE* f);
+
+// Empties the batch, keeping its buffers.
+void rome_columns_clear(struct rome_columns* columns);
+
+// Releases the buffers.
+void rome_columns_destroy(struct rome_columns* columns);
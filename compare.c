@@ -0,0 +1,68 @@
+#include <stdlib.h>
+
+#include "rome.h"
+#include "token.h"
+
+/*
+ * A canonical numeral is a sequence of groups, one per decimal digit, in decreasing order of magnitude: MM, CD, L, XXX
+ * and so on. A group is made of one or two tokens (DCC is D followed by CC) whose leading digits share the same power of
+ * ten. The value of a group is always larger than the sum of all groups that may follow it, so two numerals can be
+ * ordered by comparing their groups pairwise and stopping at the first one that differs.
+ */
+
+// Power of ten of the leading digit of a token: 0 for I, V, IV, IX; 1 for X, L, XL, XC; and so on.
+static int token_magnitude(const struct token t) {
+    const int lead = t.type == PAIR ? t.prefix : t.digit;
+    return (lead >= 10) + (lead >= 100) + (lead >= 1000);
+}
+
+// Consumes the next group from *str and returns its value. Returns 0 at the end of the numeral.
+static int next_group(char const** const str, char const* const end) {
+    struct token t;
+    struct scan_error err;
+
+    int consumed = scan_token(*str, end, &t, &err);
+    if (consumed == 0) {
+        return 0;
+    }
+    *str += consumed;
+
+    const int magnitude = token_magnitude(t);
+    int value = token_value(t);
+
+    // Every group has at most two tokens
+    struct token next;
+    consumed = scan_token(*str, end, &next, &err);
+    if (consumed > 0 && token_magnitude(next) == magnitude) {
+        *str += consumed;
+        value += token_value(next);
+    }
+    return value;
+}
+
+int rome_compare(char const* a, const size_t alen, char const* b, const size_t blen) {
+    char const* const aend = a + alen;
+    char const* const bend = b + blen;
+
+    while (a != aend || b != bend) {
+        const int ga = next_group(&a, aend);
+        const int gb = next_group(&b, bend);
+        if (ga != gb) {
+            return ga < gb ? -1 : 1;
+        }
+        if (ga == 0) {
+            break; // Both numerals ended (or stopped at an invalid token)
+        }
+    }
+    return 0;
+}
+
+static int compare_spans(void const* const lhs, void const* const rhs) {
+    struct rome_span const* const a = lhs;
+    struct rome_span const* const b = rhs;
+    return rome_compare(a->ptr, a->len, b->ptr, b->len);
+}
+
+void rome_sort(struct rome_span* const numerals, const size_t n) {
+    qsort(numerals, n, sizeof(*numerals), compare_spans);
+}
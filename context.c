@@ -0,0 +1,26 @@
+#include "context.h"
+#include "dfa.h"
+
+void rome_ctx_init(struct rome_ctx* const ctx) {
+    *ctx = (struct rome_ctx) {
+        .allocator = &rome_heap_allocator,
+        .engine = ROME_ENGINE_TOKENIZER,
+        .dialect = ROME_DIALECT_STRICT,
+        .dfa = dfa_dialect(ROME_DIALECT_STRICT),
+        .format_errors = true,
+        .stats = {0},
+    };
+}
+
+void rome_ctx_set_dialect(struct rome_ctx* const ctx, const enum rome_dialect dialect) {
+    if (dialect >= ROME_DIALECT_CUSTOM) {
+        return;
+    }
+    ctx->dialect = dialect;
+    ctx->dfa = dfa_dialect(dialect);
+}
+
+void rome_ctx_set_rules(struct rome_ctx* const ctx, struct rome_dfa const* const dfa) {
+    ctx->dialect = ROME_DIALECT_CUSTOM;
+    ctx->dfa = dfa;
+}
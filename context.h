@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "allocator.h"
+
+// Engine used to parse numerals
+enum rome_engine {
+    ROME_ENGINE_TOKENIZER, // Tokenize, validate the token sequence, and add up the tokens (see rome.c)
+    ROME_ENGINE_DFA,       // Validate with a state machine while adding up digits (see dfa.c). Falls back to the
+                           // tokenizer to describe rejected inputs.
+    ROME_ENGINE_LENIENT,   // Accept non-canonical numerals too (IIII, IC, MDCCCCX), adding up their digits and
+                           // subtracting those followed by a larger one (see lenient.c)
+    ROME_ENGINE_GENERATED, // Run the parser generated from rome.grammar at build time (see gen_parser.c). Falls back
+                           // to the tokenizer to describe rejected inputs.
+};
+
+// Rule set numerals are validated against. Each one is a set of rome_dialect_rules (see dfa.c), compiled into the DFA
+// engine's tables the first time a context selects it.
+enum rome_dialect {
+    ROME_DIALECT_STRICT,    // Canonical numerals only
+    ROME_DIALECT_CLOCK,     // Fours written additively, as on clock faces: IIII, XXXX, CCCC (but IX, XC, CM)
+    ROME_DIALECT_MEDIEVAL,  // Fours and nines written either way: IV or IIII, IX or VIIII (as in MDCCCCX)
+    ROME_DIALECT_LOWERCASE, // Canonical numerals in lowercase: xiv
+    ROME_DIALECT_EXTENDED,  // Canonical numerals with thousands overlined once, in ASCII, up to 3,999,999: _I_V is
+                            // 4000, _M is 1,000,000. M and _M repeat at most three times, and 1000 to 3999 are only
+                            // written with M (MM, not _I_I). These are the numerals rome_parse_extended reads in its
+                            // ASCII vinculum notation with single overlines; it also parses larger ones (see
+                            // extended.h).
+    ROME_DIALECT_CUSTOM,    // Rules given to rome_ctx_set_rules
+};
+
+// How fours and nines may be spelled
+enum rome_form {
+    ROME_FORM_SUBTRACTIVE = 1, // IV, IX
+    ROME_FORM_ADDITIVE = 2,    // IIII, VIIII
+    ROME_FORM_EITHER = 3,
+};
+
+// Declarative description of a dialect
+struct rome_dialect_rules {
+    enum rome_form fours;  // 4, 40, 400
+    enum rome_form nines;  // 9, 90, 900
+    int max_thousands;     // Longest run of M (up to 32), or 0 for no limit
+    bool uppercase;        // Accept IVXLCDM
+    bool lowercase;        // Accept ivxlcdm (mixing cases is allowed when both are set)
+    bool vinculum;         // Accept a leading underscore that multiplies a digit by 1000 (_V is 5000), up to _M_M_M
+};
+
+// Tables of the DFA engine for a dialect (see dfa.c)
+struct rome_dfa;
+
+// Counters updated by every call that takes the context
+struct rome_stats {
+    unsigned long long parsed;   // Number of inputs seen
+    unsigned long long rejected; // Number of inputs that were not valid numerals
+};
+
+// Parsing context. It holds everything a parse may write to, so calls sharing no context share no mutable state.
+//
+// Thread safety: a context must only be used by one thread at a time. Give each thread its own context (and its own
+// allocator state) and every entry point is reentrant. Contexts are cache-line aligned so that an array of them can be
+// written to by different threads without false sharing.
+struct rome_ctx {
+    _Alignas(64) struct rome_allocator const* allocator; // Allocator for error messages. Must outlive the results.
+    enum rome_engine engine;
+    enum rome_dialect dialect;
+    struct rome_dfa const* dfa; // The dialect's tables
+    bool format_errors; // When false, failures carry a static description of their kind and nothing is allocated
+    struct rome_stats stats;
+};
+
+// Initializes a context with the heap allocator, the tokenizer engine, the strict dialect, formatted error messages
+// and zeroed stats.
+void rome_ctx_init(struct rome_ctx* ctx);
+
+// Selects a dialect. Numerals of dialects other than the strict one are always parsed by their DFA tables, whatever the
+// engine, and rejections point at the first byte the dialect does not allow. Each dialect is compiled once per process,
+// so switching is free.
+void rome_ctx_set_dialect(struct rome_ctx* ctx, enum rome_dialect dialect);
+
+// Compiles a custom dialect. Returns NULL if the rules are invalid (no case accepted, unknown forms, a limit out of
+// range) or memory runs out. The result can be shared by any number of contexts and threads, and is freed with
+// rome_dialect_free.
+struct rome_dfa* rome_dialect_compile(struct rome_dialect_rules const* rules);
+void rome_dialect_free(struct rome_dfa* dfa);
+
+// Selects a compiled custom dialect. dfa must outlive the context's use of it.
+void rome_ctx_set_rules(struct rome_ctx* ctx, struct rome_dfa const* dfa);
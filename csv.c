@@ -0,0 +1,103 @@
+#include "csv.h"
+
+#include <string.h>
+
+void rome_csv_init(struct rome_csv* const csv, char const* delimiters, const uint64_t columns) {
+    memset(csv->delimiter, 0, sizeof(csv->delimiter));
+    for (; *delimiters != '\0'; ++delimiters) {
+        csv->delimiter[(unsigned char)*delimiters] = true;
+    }
+    csv->columns = columns;
+}
+
+// Returns the end of the field starting at str
+static char const* field_end(struct rome_csv const* const csv, char const* str, char const* const end) {
+    while (str != end && !csv->delimiter[(unsigned char)*str]) {
+        ++str;
+    }
+    return str;
+}
+
+static bool selected(struct rome_csv const* const csv, const size_t column) {
+    return column < 64 && (csv->columns >> column & 1) != 0;
+}
+
+// Writes the decimal digits of a non-negative value to out. Returns how many were written.
+static size_t write_decimal(int value, char* const out) {
+    char digits[16];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+size_t rome_csv_parse_row(struct rome_ctx* const ctx, struct rome_csv const* const csv, char const* const row,
+                          const size_t len, int32_t* const values, enum rome_error_kind* const kinds) {
+    char const* const end = row + len;
+    char const* field = row;
+    size_t found = 0;
+
+    for (size_t column = 0; ; ++column) {
+        char const* const stop = field_end(csv, field, end);
+        if (selected(csv, column)) {
+            const struct result res = rome_parse_n(ctx, field, (size_t)(stop - field));
+            values[found] = res.value;
+            kinds[found] = res.kind;
+            free_result(res);
+            ++found;
+        }
+        if (stop == end) {
+            return found;
+        }
+        field = stop + 1;
+    }
+}
+
+long rome_csv_rewrite_row(struct rome_ctx* const ctx, struct rome_csv const* const csv, char const* const row,
+                          const size_t len, char* const out, const size_t outlen) {
+    char const* const end = row + len;
+    char const* field = row;
+    size_t pos = 0;
+
+    for (size_t column = 0; ; ++column) {
+        char const* const stop = field_end(csv, field, end);
+        // Copy the field and its delimiter, if any
+        const size_t n = (size_t)(stop - field) + (stop != end);
+
+        struct result res = {0};
+        if (selected(csv, column)) {
+            res = rome_parse_n(ctx, field, (size_t)(stop - field));
+        }
+
+        if (selected(csv, column) && res.error == NULL) {
+            char digits[16];
+            const size_t d = write_decimal(res.value, digits);
+            if (outlen - pos < d + (stop != end)) {
+                return -1;
+            }
+            memcpy(out + pos, digits, d);
+            pos += d;
+            if (stop != end) {
+                out[pos++] = *stop;
+            }
+        } else {
+            free_result(res);
+            if (outlen - pos < n) {
+                return -1;
+            }
+            memcpy(out + pos, field, n);
+            pos += n;
+        }
+
+        if (stop == end) {
+            return (long)pos;
+        }
+        field = stop + 1;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rome.h"
+
+// Delimited rows (CSV, TSV, ...) with numerals in some of their columns.
+// Fields are parsed in place with rome_parse_n: rows are never split into temporary strings. Quoting is not supported,
+// so delimiters cannot appear inside fields.
+struct rome_csv {
+    bool delimiter[256]; // Whether each byte separates fields
+    uint64_t columns;    // Bit i is set if column i (counting from 0) holds numerals. Columns past 63 are never selected.
+};
+
+// Prepares a CSV layout from a set of delimiter characters (e.g. ",", "\t" or ",;") and a column selection.
+void rome_csv_init(struct rome_csv* csv, char const* delimiters, uint64_t columns);
+
+// Parses the selected columns of a row, which must not include its newline.
+// The k-th selected column found is written to values[k] and its status to kinds[k], so both need room for as many
+// entries as selected columns. Returns the number of selected columns found in the row.
+size_t rome_csv_parse_row(struct rome_ctx* ctx, struct rome_csv const* csv, char const* row, size_t len,
+                          int32_t* values, enum rome_error_kind* kinds);
+
+// Copies a row (without its newline) to out, replacing each valid numeral in the selected columns with its value.
+// Fields that are not valid numerals are copied unchanged. Returns the length written, or -1 if it does not fit in
+// outlen bytes. A value can be longer than its numeral, but at most four times as long (M -> 1000), so four times the
+// row length is always enough.
+long rome_csv_rewrite_row(struct rome_ctx* ctx, struct rome_csv const* csv, char const* row, size_t len,
+                          char* out, size_t outlen);
@@ -0,0 +1,407 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dfa.h"
+#include "rome.h"
+
+/*
+ * Table-driven engine. It accepts exactly the numerals of a dialect (the strict one accepts those parse_roman_number
+ * accepts), but it never builds tokens or formats errors: every byte costs three table lookups.
+ *
+ * The automaton follows the structure of a canonical numeral: a run of M, then one group per decimal digit (hundreds,
+ * tens, units). Each group is spelled with its "one", "five" and "ten" digits (C, D, M for the hundreds), and its states
+ * are the prefixes of the spellings the dialect allows. With the strict rules, they are:
+ *     o                    can be followed by one, five, ten (IV, IX) or any lower group
+ *     oo, fo, foo          can be followed by one or any lower group
+ *     ooo, fooo, of, ot    can only be followed by a lower group
+ *     f                    can be followed by one or any lower group
+ * which are the rules valid_pair, valid_repeats and valid_sequence implement. Other dialects add spellings (IIII,
+ * VIIII), change the letters, limit the run of M, or put overlined runs and groups in front (_M, _C _D _M, ...). The
+ * overlined units can only start a numeral with their four or nine (_I_V, _I_X), so that 1000 to 3999 keep their only
+ * spelling in M.
+ *
+ * The tables are compiled from a struct rome_dialect_rules: once per process for the built-in dialects, and by
+ * rome_dialect_compile for custom ones. Each transition also carries what it adds to the value: the digit, minus twice
+ * the previous digit when that turns out to be a prefix (IV adds 1, then 5-2). Whatever the dialect, parsing is then
+ * the same loop over the same tables, with no branch on the rules.
+ */
+
+enum byte_class {
+    C_OTHER, // Anything that is not a digit of the dialect
+    C_I,
+    C_V,
+    C_X,
+    C_L,
+    C_C,
+    C_D,
+    C_M,
+    C_BAR,   // The vinculum's underscore
+};
+
+// Digits as the automaton reads them: the seven letters (I = 0, ..., M = 6), then the same letters overlined
+enum { GLYPHS = 14, OVERLINED = 7 };
+enum { I, V, X, L, C, D, M };
+
+enum { S_REJECT, S_START };
+
+static const int32_t letter_values[7] = {1, 5, 10, 50, 100, 500, 1000};
+
+static int32_t glyph_value(const int glyph) {
+    return glyph < OVERLINED ? letter_values[glyph] : 1000 * letter_values[glyph - OVERLINED];
+}
+
+// A part of a numeral, in decreasing order of magnitude: a run of one digit (MMM), or a decimal group
+struct element {
+    bool run;
+    int one, five, ten; // Glyphs. Runs only have a one.
+    int limit;          // Longest run, or 0 for no limit
+    bool leading;       // Can only start a numeral
+    bool follows;       // Can only start a numeral with its four or nine (_I_V, but not _I, which is M)
+};
+
+// The automaton over glyphs, before underscores are spelled out as bytes
+struct glyph_dfa {
+    int states;
+    uint8_t next[DFA_MAX_STATES][GLYPHS];
+    int32_t last[DFA_MAX_STATES]; // Value of the glyph that led to each state (0 for the start)
+    bool partial[DFA_MAX_STATES]; // Neither accepting nor followed by lower elements
+};
+
+static int add_state(struct glyph_dfa* const g, const int glyph) {
+    if (g->states == DFA_MAX_STATES) {
+        return -1;
+    }
+    g->last[g->states] = glyph < 0 ? 0 : glyph_value(glyph);
+    return g->states++;
+}
+
+// Adds the states of an element. entries[glyph] is where the element starts on each glyph (0 where it cannot), and
+// starts[glyph] where it starts a numeral. Returns false if there are too many states.
+static bool add_element(struct glyph_dfa* const g, struct element const* const e, char const* const* const spellings,
+                        const int count, uint8_t entries[GLYPHS], uint8_t starts[GLYPHS]) {
+    if (e->run) {
+        const int first = add_state(g, e->one);
+        if (first < 0) {
+            return false;
+        }
+        entries[e->one] = (uint8_t)first;
+        int prev = first;
+        for (int i = 1; i < e->limit; ++i) {
+            const int s = add_state(g, e->one);
+            if (s < 0) {
+                return false;
+            }
+            g->next[prev][e->one] = (uint8_t)s;
+            prev = s;
+        }
+        if (e->limit == 0) {
+            g->next[first][e->one] = (uint8_t)first;
+        }
+        starts[e->one] = entries[e->one];
+        return true;
+    }
+
+    // A trie of the spellings, where o, f and t stand for the one, five and ten
+    for (int i = 0; i < count; ++i) {
+        int state = -1;
+        for (char const* it = spellings[i]; *it != '\0'; ++it) {
+            const int glyph = *it == 'o' ? e->one : *it == 'f' ? e->five : e->ten;
+            uint8_t* const next = state < 0 ? &entries[glyph] : &g->next[state][glyph];
+            if (*next == S_REJECT) {
+                const int s = add_state(g, glyph);
+                if (s < 0) {
+                    return false;
+                }
+                *next = (uint8_t)s;
+            }
+            state = *next;
+        }
+    }
+
+    for (int glyph = 0; glyph < GLYPHS; ++glyph) {
+        starts[glyph] = entries[glyph];
+    }
+    if (e->follows && entries[e->one] != S_REJECT) {
+        // A numeral starts on a copy of the one's state that only goes on with the five or the ten
+        const int one = entries[e->one];
+        const int s = add_state(g, e->one);
+        if (s < 0) {
+            return false;
+        }
+        g->partial[s] = true;
+        g->next[s][e->five] = g->next[one][e->five];
+        g->next[s][e->ten] = g->next[one][e->ten];
+        starts[e->one] = (uint8_t)s;
+    }
+    return true;
+}
+
+// Compiles rules into dfa, using g as scratch space. Returns false if they are invalid.
+static bool compile(struct rome_dialect_rules const* const rules, struct glyph_dfa* const g,
+                    struct rome_dfa* const dfa) {
+    const bool valid_forms = rules->fours >= ROME_FORM_SUBTRACTIVE && rules->fours <= ROME_FORM_EITHER
+        && rules->nines >= ROME_FORM_SUBTRACTIVE && rules->nines <= ROME_FORM_EITHER;
+    if (!valid_forms || (!rules->uppercase && !rules->lowercase) || rules->max_thousands < 0
+        || rules->max_thousands > 32) {
+        return false;
+    }
+
+    // The seven spellings every dialect allows, and up to two for each of fours and nines
+    char const* spellings[7 + 2 + 2] = {"o", "oo", "ooo", "f", "fo", "foo", "fooo"};
+    int count = 7;
+    if (rules->fours & ROME_FORM_SUBTRACTIVE) {
+        spellings[count++] = "of";
+    }
+    if (rules->fours & ROME_FORM_ADDITIVE) {
+        spellings[count++] = "oooo";
+    }
+    if (rules->nines & ROME_FORM_SUBTRACTIVE) {
+        spellings[count++] = "ot";
+    }
+    if (rules->nines & ROME_FORM_ADDITIVE) {
+        spellings[count++] = "foooo";
+    }
+    assert(count <= (int)(sizeof(spellings) / sizeof(spellings[0])));
+
+    struct element elements[8];
+    int n = 0;
+    if (rules->vinculum) {
+        elements[n++] = (struct element) {.run = true, .one = OVERLINED + M, .limit = 3};
+        elements[n++] = (struct element) {.one = OVERLINED + C, .five = OVERLINED + D, .ten = OVERLINED + M};
+        elements[n++] = (struct element) {.one = OVERLINED + X, .five = OVERLINED + L, .ten = OVERLINED + C};
+        elements[n++] = (struct element) {.one = OVERLINED + I, .five = OVERLINED + V, .ten = OVERLINED + X,
+                                          .follows = true};
+    }
+    // With the vinculum, M only leads small numerals (MMM); otherwise it is the first element anyway
+    elements[n++] = (struct element) {.run = true, .one = M, .limit = rules->max_thousands, .leading = true};
+    elements[n++] = (struct element) {.one = C, .five = D, .ten = M};
+    elements[n++] = (struct element) {.one = X, .five = L, .ten = C};
+    elements[n++] = (struct element) {.one = I, .five = V, .ten = X};
+
+    static struct glyph_dfa const empty_glyph_dfa;
+    *g = empty_glyph_dfa;
+    g->states = S_START + 1;
+
+    uint8_t entries[8][GLYPHS] = {{0}};
+    uint8_t starts[8][GLYPHS] = {{0}};
+    int first_state[9];
+    for (int i = 0; i < n; ++i) {
+        first_state[i] = g->states;
+        if (!add_element(g, &elements[i], spellings, count, entries[i], starts[i])) {
+            return false;
+        }
+    }
+    first_state[n] = g->states;
+
+    // Any state may go on with a lower element, where its own transitions leave off. The start goes on with any, on
+    // the states where each starts a numeral.
+    for (int i = -1; i < n; ++i) {
+        const int begin = i < 0 ? S_START : first_state[i];
+        const int end = i < 0 ? S_START + 1 : first_state[i + 1];
+        for (int s = begin; s < end; ++s) {
+            if (g->partial[s]) {
+                continue;
+            }
+            for (int j = i + 1; j < n; ++j) {
+                if (elements[j].leading && i >= 0) {
+                    continue;
+                }
+                uint8_t const* const to = i < 0 ? starts[j] : entries[j];
+                for (int glyph = 0; glyph < GLYPHS; ++glyph) {
+                    if (to[glyph] != S_REJECT && g->next[s][glyph] == S_REJECT) {
+                        g->next[s][glyph] = to[glyph];
+                    }
+                }
+            }
+        }
+    }
+
+    // Spell the glyphs out as bytes. An underscore leads to a copy of the state that reads letters overlined.
+    static struct rome_dfa const empty_dfa;
+    *dfa = empty_dfa;
+    static char const upper[] = "IVXLCDM", lower[] = "ivxlcdm";
+    for (int i = 0; i < 7; ++i) {
+        if (rules->uppercase) {
+            dfa->char_class[(unsigned char)upper[i]] = (uint8_t)(C_I + i);
+        }
+        if (rules->lowercase) {
+            dfa->char_class[(unsigned char)lower[i]] = (uint8_t)(C_I + i);
+        }
+    }
+    if (rules->vinculum) {
+        dfa->char_class['_'] = C_BAR;
+    }
+
+    int states = g->states;
+    bool ok = true;
+    for (int s = S_START; s < g->states && ok; ++s) {
+        dfa->accepting[s] = s > S_START && !g->partial[s];
+        for (int bar = 0; bar < (rules->vinculum ? 2 : 1); ++bar) {
+            int from = s;
+            if (bar) {
+                if (states == DFA_MAX_STATES) {
+                    ok = false;
+                    break;
+                }
+                from = states++;
+                dfa->next[s][C_BAR] = (uint8_t)from;
+            }
+            for (int letter = 0; letter < 7; ++letter) {
+                const int glyph = bar * OVERLINED + letter;
+                const uint8_t to = g->next[s][glyph];
+                if (to == S_REJECT) {
+                    continue;
+                }
+                const int32_t value = glyph_value(glyph);
+                dfa->next[from][C_I + letter] = to;
+                dfa->delta[from][C_I + letter] = value - (g->last[s] < value ? 2 * g->last[s] : 0);
+            }
+        }
+    }
+    return ok;
+}
+
+// The built-in dialects
+static const struct rome_dialect_rules builtin_rules[ROME_DIALECT_CUSTOM] = {
+    [ROME_DIALECT_STRICT] = {.fours = ROME_FORM_SUBTRACTIVE, .nines = ROME_FORM_SUBTRACTIVE, .uppercase = true},
+    [ROME_DIALECT_CLOCK] = {.fours = ROME_FORM_ADDITIVE, .nines = ROME_FORM_SUBTRACTIVE, .uppercase = true},
+    [ROME_DIALECT_MEDIEVAL] = {.fours = ROME_FORM_EITHER, .nines = ROME_FORM_EITHER, .uppercase = true},
+    [ROME_DIALECT_LOWERCASE] = {.fours = ROME_FORM_SUBTRACTIVE, .nines = ROME_FORM_SUBTRACTIVE, .lowercase = true},
+    [ROME_DIALECT_EXTENDED] = {.fours = ROME_FORM_SUBTRACTIVE, .nines = ROME_FORM_SUBTRACTIVE, .max_thousands = 3,
+                               .uppercase = true, .vinculum = true},
+};
+
+enum { UNCOMPILED, COMPILING, COMPILED };
+
+static struct rome_dfa builtin_dfas[ROME_DIALECT_CUSTOM];
+static atomic_int builtin_status[ROME_DIALECT_CUSTOM];
+// Each built-in dialect has its own scratch space, so that compiling one cannot fail, even while another compiles
+static struct glyph_dfa builtin_scratch[ROME_DIALECT_CUSTOM];
+
+struct rome_dfa const* dfa_dialect(const enum rome_dialect dialect) {
+    atomic_int* const status = &builtin_status[dialect];
+    if (atomic_load_explicit(status, memory_order_acquire) != COMPILED) {
+        int expected = UNCOMPILED;
+        if (atomic_compare_exchange_strong(status, &expected, COMPILING)) {
+            // The built-in rules are valid and fit in DFA_MAX_STATES, which gen_table checks at build time
+            const bool compiled = compile(&builtin_rules[dialect], &builtin_scratch[dialect], &builtin_dfas[dialect]);
+            assert(compiled);
+            (void)compiled;
+            atomic_store_explicit(status, COMPILED, memory_order_release);
+        }
+        while (atomic_load_explicit(status, memory_order_acquire) != COMPILED) {
+            // Another thread is compiling it, which takes microseconds
+        }
+    }
+    return &builtin_dfas[dialect];
+}
+
+struct rome_dfa* rome_dialect_compile(struct rome_dialect_rules const* const rules) {
+    struct glyph_dfa* const g = malloc(sizeof(*g));
+    struct rome_dfa* dfa = malloc(sizeof(*dfa));
+    if (g == NULL || dfa == NULL || !compile(rules, g, dfa)) {
+        free(dfa);
+        dfa = NULL;
+    }
+    free(g);
+    return dfa;
+}
+
+void rome_dialect_free(struct rome_dfa* const dfa) {
+    free(dfa);
+}
+
+static inline uint8_t step(struct rome_dfa const* const dfa, const uint8_t state, const char c) {
+    return dfa->next[state][dfa->char_class[(unsigned char)c]];
+}
+
+bool rome_is_valid(char const* const ptr, const size_t len) {
+    struct rome_dfa const* const dfa = dfa_dialect(ROME_DIALECT_STRICT);
+    uint8_t state = S_START;
+    for (size_t i = 0; i < len; ++i) {
+        state = step(dfa, state, ptr[i]);
+    }
+    return dfa->accepting[state];
+}
+
+bool dfa_parse(struct rome_dfa const* const dfa, char const* const ptr, const size_t len, int* const value) {
+    uint8_t state = S_START;
+    int64_t sum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        const uint8_t c = dfa->char_class[(unsigned char)ptr[i]];
+        sum += dfa->delta[state][c];
+        state = dfa->next[state][c];
+    }
+
+    if (!dfa->accepting[state] || sum > INT32_MAX) {
+        return false;
+    }
+    *value = (int)sum;
+    return true;
+}
+
+void dfa_explain(struct rome_dfa const* const dfa, char const* const ptr, const size_t len,
+                 struct scan_error* const err) {
+    if (len == 0) {
+        *err = (struct scan_error) {.kind = ROME_ERROR_EMPTY, .offset = 0, .length = 0};
+        return;
+    }
+
+    uint8_t state = S_START;
+    for (size_t i = 0; i < len; ++i) {
+        const uint8_t c = dfa->char_class[(unsigned char)ptr[i]];
+        state = dfa->next[state][c];
+        if (state == S_REJECT) {
+            const enum rome_error_kind kind = c == C_OTHER ? ROME_ERROR_BAD_CHARACTER : ROME_ERROR_BAD_SEQUENCE;
+            *err = (struct scan_error) {.kind = kind, .offset = (int)i, .length = 1};
+            return;
+        }
+    }
+    if (!dfa->accepting[state]) {
+        // Only an underscore can be left dangling
+        *err = (struct scan_error) {.kind = ROME_ERROR_BAD_SEQUENCE, .offset = (int)len - 1, .length = 1};
+        return;
+    }
+    *err = (struct scan_error) {.kind = ROME_ERROR_OVERFLOW, .offset = 0, .length = (int)len};
+}
+
+void rome_is_valid_batch(char const* const* const ptrs, size_t const* const lens, const size_t n, uint64_t* const valid) {
+    struct rome_dfa const* const dfa = dfa_dialect(ROME_DIALECT_STRICT);
+    for (size_t w = 0; w < (n + 63) / 64; ++w) {
+        valid[w] = 0;
+    }
+
+    // Rows are validated four at a time, in lockstep over their common length. The four lookup chains are independent,
+    // so the CPU can overlap their latencies instead of waiting on one row at a time.
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint8_t s0 = S_START, s1 = S_START, s2 = S_START, s3 = S_START;
+
+        size_t common = lens[i];
+        for (size_t k = 1; k < 4; ++k) {
+            common = lens[i + k] < common ? lens[i + k] : common;
+        }
+
+        for (size_t j = 0; j < common; ++j) {
+            s0 = step(dfa, s0, ptrs[i][j]);
+            s1 = step(dfa, s1, ptrs[i + 1][j]);
+            s2 = step(dfa, s2, ptrs[i + 2][j]);
+            s3 = step(dfa, s3, ptrs[i + 3][j]);
+        }
+
+        uint8_t states[4] = {s0, s1, s2, s3};
+        for (size_t k = 0; k < 4; ++k) {
+            for (size_t j = common; j < lens[i + k]; ++j) {
+                states[k] = step(dfa, states[k], ptrs[i + k][j]);
+            }
+            valid[(i + k) / 64] |= (uint64_t)dfa->accepting[states[k]] << ((i + k) % 64);
+        }
+    }
+
+    for (; i < n; ++i) {
+        valid[i / 64] |= (uint64_t)rome_is_valid(ptrs[i], lens[i]) << (i % 64);
+    }
+}
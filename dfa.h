@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "token.h"
+
+// Internal header: the DFA engine (see dfa.c).
+
+// Byte classes: anything else, the seven letters, and the vinculum's underscore
+enum { DFA_CLASSES = 9 };
+
+// Enough for every dialect rome_dialect_rules can describe (states are bytes)
+enum { DFA_MAX_STATES = 256 };
+
+struct rome_dfa {
+    uint8_t char_class[256];
+    uint8_t next[DFA_MAX_STATES][DFA_CLASSES];   // 0 is the sink state
+    int32_t delta[DFA_MAX_STATES][DFA_CLASSES];  // What each transition adds to the value
+    bool accepting[DFA_MAX_STATES];
+};
+
+// Tables of a built-in dialect, compiled on first use.
+struct rome_dfa const* dfa_dialect(enum rome_dialect dialect);
+
+// Parses the len bytes at ptr with the tables of a dialect and writes their value to *value.
+// Returns false if they are not a numeral of the dialect or the value does not fit in an int. It never allocates.
+bool dfa_parse(struct rome_dfa const* dfa, char const* ptr, size_t len, int* value);
+
+// Works out why dfa_parse rejected the len bytes at ptr: where the tables reached the sink state (a character outside
+// the dialect is ROME_ERROR_BAD_CHARACTER, any other ROME_ERROR_BAD_SEQUENCE), or an empty or too large numeral.
+void dfa_explain(struct rome_dfa const* dfa, char const* ptr, size_t len, struct scan_error* err);
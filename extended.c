@@ -0,0 +1,373 @@
+#include <string.h>
+
+#include "extended.h"
+#include "token.h"
+
+/*
+ * Numerals are parsed as in rome.c, but over a longer ladder of digits. Every spelling of a digit (V, _V, V̅, IↃↃ, ...)
+ * is read as a glyph: its position on the ladder, where I is 0, V is 1, X is 2 and so on, and one overline adds 6. The
+ * tokens are the usual pairs and repeats of glyphs (struct token, holding ladder positions instead of values), and the
+ * rules of valid_pair, valid_repeats and valid_sequence carry over to any position: powers of ten are at even
+ * positions and fives at odd ones.
+ *
+ * Powers of a thousand have two vinculum spellings on the same rung: M and I̅ are both 1000, M̅ and I̿ a million. Which
+ * one is allowed depends on where the glyph is, as in rome_format_extended: M in a run that starts the numeral (MMM,
+ * M̅M̅) and as the ten of a nine (CM, C̅M̅), the overlined I everywhere else (I̅V̅, X̅I̅I̅). So I̅ and I̅V are rejected
+ * (they would be a second spelling of M and MV), and each value has a single vinculum spelling.
+ */
+
+// Highest position: 10^19 does not fit in int64_t, but it is needed as the ten of a 9 (CM) in the highest digit
+enum { MAX_POSITION = 38 };
+
+// Longest run of C or ( an apostrophus glyph is looked for in. Longer runs are read as plain C, and rejected as such,
+// so that reading each glyph takes constant time.
+enum { MAX_APOSTROPHUS = 24 };
+
+// UTF-8 encodings of the combining overline U+0305 and of the reversed C U+2183
+#define OVERLINE "\xCC\x85"
+#define REVERSED_C "\xE2\x86\x83"
+
+static char const letters[] = "IVXLCDM";
+
+// Position of each letter, plus one; 0 for other bytes
+static const unsigned char letter_positions[256] = {
+    ['I'] = 1, ['V'] = 2, ['X'] = 3, ['L'] = 4, ['C'] = 5, ['D'] = 6, ['M'] = 7,
+};
+
+struct glyph {
+    int position; // Position on the ladder
+    int length;   // Bytes in the input
+    bool as_i;    // A power of a thousand spelled as an overlined I (I̅, _I)
+    bool as_m;    // A power of a thousand spelled as an M (M, M̅, _M)
+};
+
+static const int64_t powers_of_ten[19] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000, 100000000000,
+    1000000000000, 10000000000000, 100000000000000, 1000000000000000, 10000000000000000, 100000000000000000,
+    1000000000000000000,
+};
+
+// Value of a position below MAX_POSITION
+static int64_t position_value(const int position) {
+    return (position % 2 == 0 ? 1 : 5) * powers_of_ten[position / 2];
+}
+
+// Length of the closing mark of an apostrophus at str (Ↄ or ')'), or 0 if there is none
+static int closing_length(char const* const str, char const* const end) {
+    if (str != end && *str == ')') {
+        return 1;
+    }
+    if (end - str >= 3 && memcmp(str, REVERSED_C, 3) == 0) {
+        return 3;
+    }
+    return 0;
+}
+
+// Reads an apostrophus glyph at str: C^n I Ↄ^n, (^n I )^n, or I followed by n of either mark. Returns false if there is
+// none, in which case the first character (if it is a C or an I) is a plain letter. Otherwise *kind is ROME_OK, or
+// ROME_ERROR_BAD_CHARACTER if the marks mix spellings (CI), (IↃ).
+static bool read_apostrophus(char const* const str, char const* const end, struct glyph* const g,
+                             enum rome_error_kind* const kind) {
+    const char open = *str;
+    int opening = 0;
+    if (open == 'C' || open == '(') {
+        while (opening < MAX_APOSTROPHUS && str + opening != end && str[opening] == open) {
+            ++opening;
+        }
+    }
+    char const* it = str + opening;
+    if (it == end || *it != 'I') {
+        return false;
+    }
+    ++it;
+
+    const int mark = closing_length(it, end);
+    int closing = 0;
+    while (mark != 0 && closing < MAX_APOSTROPHUS && closing_length(it, end) == mark) {
+        it += mark;
+        ++closing;
+    }
+    if (closing == 0) {
+        return false;
+    }
+
+    *kind = ROME_OK;
+    if (opening > 0 && (open == '(') != (mark == 1)) {
+        *kind = ROME_ERROR_BAD_CHARACTER;
+        return true;
+    }
+    if (opening == closing) {
+        *g = (struct glyph) {.position = 2 * closing + 4, .length = (int)(it - str)};
+        return true;
+    }
+    if (opening == 0) {
+        *g = (struct glyph) {.position = 2 * closing + 3, .length = (int)(it - str)};
+        return true;
+    }
+    // C that are not part of the glyph are plain letters, read one at a time; ( cannot stand alone
+    return false;
+}
+
+// Reads the glyph at str. Returns ROME_OK, or why it could not be read.
+static enum rome_error_kind read_glyph(char const* const str, char const* const end, struct glyph* const g) {
+    enum rome_error_kind kind;
+    if ((*str == 'C' || *str == '(' || *str == 'I') && read_apostrophus(str, end, g, &kind)) {
+        if (kind != ROME_OK) {
+            return kind;
+        }
+        return g->position > MAX_POSITION ? ROME_ERROR_OVERFLOW : ROME_OK;
+    }
+
+    char const* it = str;
+    size_t overlines = 0;
+    while (it != end && *it == '_') {
+        ++overlines;
+        ++it;
+    }
+    const int letter = it == end ? 0 : letter_positions[(unsigned char)*it];
+    if (letter == 0) {
+        return ROME_ERROR_BAD_CHARACTER;
+    }
+    ++it;
+    while (end - it >= 2 && memcmp(it, OVERLINE, 2) == 0) {
+        ++overlines;
+        it += 2;
+    }
+
+    const size_t position = (size_t)(letter - 1) + 6 * overlines;
+    if (position > MAX_POSITION) {
+        return ROME_ERROR_OVERFLOW;
+    }
+    const bool thousand = position % 6 == 0 && position > 0;
+    *g = (struct glyph) {
+        .position = (int)position,
+        .length = (int)(it - str),
+        .as_i = thousand && letter == letter_positions['I'],
+        .as_m = thousand && letter == letter_positions['M'],
+    };
+    return ROME_OK;
+}
+
+static bool same_spelling(char const* const a, struct glyph const* const ga, char const* const b,
+                          struct glyph const* const gb) {
+    return ga->length == gb->length && memcmp(a, b, (size_t)ga->length) == 0;
+}
+
+// valid_pair, on the ladder: IV, IX, XL, XC, ..., I̅V̅, I̅X̅
+static bool ladder_pair(const int prefix, const int suffix) {
+    return prefix % 2 == 0 && (suffix == prefix + 1 || suffix == prefix + 2);
+}
+
+// valid_repeats, on the ladder. Every power of ten, M included, repeats up to three times.
+static bool ladder_repeats(const int position, const int count) {
+    return position % 2 == 0 ? count <= 3 : count == 1;
+}
+
+// valid_sequence, on the ladder
+static bool ladder_sequence(const struct token first, const struct token second) {
+    const int first_prefix = first.type == PAIR ? first.prefix : first.digit;
+    if (first_prefix % 2 == 1) {
+        return first_prefix > (second.type == PAIR ? second.suffix : second.digit);
+    }
+    return first_prefix > (second.type == PAIR ? second.prefix : second.digit);
+}
+
+static bool add_ladder_token(int64_t* const tally, const struct token t) {
+    int64_t value;
+    if (t.type == REPEAT) {
+        if (t.digit == MAX_POSITION || __builtin_mul_overflow(position_value(t.digit), (int64_t)t.count, &value)) {
+            return false;
+        }
+    } else {
+        // A four or a nine of the prefix
+        value = position_value(t.prefix) * (t.suffix == t.prefix + 1 ? 4 : 9);
+    }
+    return !__builtin_add_overflow(*tally, value, tally);
+}
+
+// Reads the token at str, as scan_token does, and its glyphs (the repeated one, or the prefix and the suffix). Returns
+// the bytes consumed, or 0 with *kind saying why.
+static int read_token(char const* const str, char const* const end, struct token* const t, struct glyph glyphs[2],
+                      enum rome_error_kind* const kind) {
+    struct glyph first;
+    if ((*kind = read_glyph(str, end, &first)) != ROME_OK) {
+        return 0;
+    }
+    glyphs[0] = first;
+    char const* it = str + first.length;
+    if (it == end) {
+        *t = (struct token) {.type = REPEAT, .digit = first.position, .count = 1};
+        return first.length;
+    }
+
+    struct glyph second;
+    if ((*kind = read_glyph(it, end, &second)) != ROME_OK) {
+        return 0;
+    }
+
+    if (first.position < second.position) {
+        if (!ladder_pair(first.position, second.position)) {
+            *kind = ROME_ERROR_BAD_PAIR;
+            return 0;
+        }
+        *t = (struct token) {.type = PAIR, .prefix = first.position, .suffix = second.position};
+        glyphs[1] = second;
+        return first.length + second.length;
+    }
+
+    // Repetition: keep reading while the digit is spelled the same way
+    int count = 1;
+    while (same_spelling(str, &first, it, &second)) {
+        ++count;
+        it += second.length;
+        if (count > 3 || it == end || read_glyph(it, end, &second) != ROME_OK) {
+            break;
+        }
+    }
+    if (!ladder_repeats(first.position, count)) {
+        *kind = ROME_ERROR_BAD_REPEAT;
+        return 0;
+    }
+    *t = (struct token) {.type = REPEAT, .digit = first.position, .count = count};
+    return (int)(it - str);
+}
+
+// Whether the powers of a thousand in a token are spelled as they must be where it is (see the top of the file)
+static bool thousands_spelled(const struct token t, struct glyph const glyphs[2], const bool leading) {
+    if (t.type == REPEAT) {
+        return leading ? !glyphs[0].as_i : !glyphs[0].as_m;
+    }
+    return !glyphs[0].as_m && !glyphs[1].as_i;
+}
+
+enum rome_error_kind rome_parse_extended(char const* const ptr, const size_t len, int64_t* const value) {
+    if (len == 0) {
+        return ROME_ERROR_EMPTY;
+    }
+
+    char const* str = ptr;
+    char const* const end = ptr + len;
+    struct token prev = {0}; // Only read from the second token on, as in scan_numeral
+    int64_t tally = 0;
+    enum rome_error_kind kind;
+
+    while (str != end) {
+        struct token next;
+        struct glyph glyphs[2];
+        const int consumed = read_token(str, end, &next, glyphs, &kind);
+        if (consumed == 0) {
+            return kind;
+        }
+        if (!thousands_spelled(next, glyphs, str == ptr)) {
+            return next.type == PAIR ? ROME_ERROR_BAD_PAIR : ROME_ERROR_BAD_SEQUENCE;
+        }
+        if (str != ptr && !ladder_sequence(prev, next)) {
+            return ROME_ERROR_BAD_SEQUENCE;
+        }
+        if (!add_ladder_token(&tally, next)) {
+            return ROME_ERROR_OVERFLOW;
+        }
+        str += consumed;
+        prev = next;
+    }
+
+    *value = tally;
+    return ROME_OK;
+}
+
+// Output buffer that remembers whether everything fit
+struct sink {
+    char* out;
+    size_t len;
+    size_t pos;
+};
+
+static void put(struct sink* const s, char const* const str, const size_t n) {
+    if (s->pos + n < s->len) {
+        memcpy(s->out + s->pos, str, n);
+    }
+    s->pos += n;
+}
+
+// Writes the glyph at a position of the ladder. In the vinculum notations, a power of a thousand can be spelled as an
+// overlined I or as an M with one overline less: as_m picks the latter.
+static void put_glyph(struct sink* const s, const enum rome_notation notation, const int position, const bool as_m) {
+    switch (notation) {
+        case ROME_NOTATION_VINCULUM:
+        case ROME_NOTATION_VINCULUM_ASCII: {
+            const bool m = as_m && position % 6 == 0 && position > 0;
+            const int level = position / 6 - m;
+            if (notation == ROME_NOTATION_VINCULUM_ASCII) {
+                for (int i = 0; i < level; ++i) {
+                    put(s, "_", 1);
+                }
+            }
+            put(s, m ? "M" : &letters[position % 6], 1);
+            if (notation == ROME_NOTATION_VINCULUM) {
+                for (int i = 0; i < level; ++i) {
+                    put(s, OVERLINE, 2);
+                }
+            }
+            return;
+        }
+        case ROME_NOTATION_APOSTROPHUS:
+        case ROME_NOTATION_APOSTROPHUS_ASCII: {
+            if (position < 6) {
+                put(s, &letters[position], 1);
+                return;
+            }
+            const bool ascii = notation == ROME_NOTATION_APOSTROPHUS_ASCII;
+            const int n = position % 2 == 0 ? (position - 4) / 2 : (position - 3) / 2;
+            for (int i = 0; position % 2 == 0 && i < n; ++i) {
+                put(s, ascii ? "(" : "C", 1);
+            }
+            put(s, "I", 1);
+            for (int i = 0; i < n; ++i) {
+                put(s, ascii ? ")" : REVERSED_C, ascii ? 1 : 3);
+            }
+            return;
+        }
+    }
+}
+
+int rome_format_extended(int64_t value, const enum rome_notation notation, char* const out, const size_t len) {
+    if (value <= 0 || len == 0) {
+        return -1;
+    }
+
+    int digits[19];
+    int top = -1;
+    while (value > 0) {
+        digits[++top] = (int)(value % 10);
+        value /= 10;
+    }
+
+    // Decimal digits are spelled one after the other with their one, five and ten, as in format.c. A leading run of
+    // thousands (MMM, M̅M̅) is spelled with M, and so is the ten of CM; other thousands are overlined I (I̅V̅, X̅I̅I̅).
+    struct sink s = {.out = out, .len = len, .pos = 0};
+    for (int p = top; p >= 0; --p) {
+        const int d = digits[p];
+        const int one = 2 * p, five = 2 * p + 1, ten = 2 * p + 2;
+        const bool leading = p == top;
+        if (d == 9) {
+            put_glyph(&s, notation, one, false);
+            put_glyph(&s, notation, ten, true);
+        } else if (d == 4) {
+            put_glyph(&s, notation, one, false);
+            put_glyph(&s, notation, five, false);
+        } else {
+            if (d >= 5) {
+                put_glyph(&s, notation, five, false);
+            }
+            for (int i = 0; i < d % 5; ++i) {
+                put_glyph(&s, notation, one, leading && d < 4);
+            }
+        }
+    }
+
+    if (s.pos >= len) {
+        return -1;
+    }
+    out[s.pos] = '\0';
+    return (int)s.pos;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+
+// Numerals past 3999, in the two historical notations for large values, as 64-bit integers.
+//
+// Vinculum: an overline multiplies a digit by 1000, so V̅ is 5000 and M̅ is 1,000,000. Overlines stack (V̿ is 5,000,000).
+// It is written either as the combining overline U+0305 after the digit, or as an underscore before it (_V).
+//
+// Apostrophus: IↃ is 500 and every further Ↄ (U+2183) multiplies by ten, so IↃↃ is 5000. Enclosing it in as many C as
+// there are Ↄ doubles it: CIↃ is 1000, CCIↃↃ is 10,000. (I) and ((I)) are the ASCII spellings of CIↃ and CCIↃↃ, and
+// I) that of IↃ; the closing marks of an enclosed glyph match its opening ones, so CI) and (IↃ are rejected.
+// C and Ↄ pair greedily: CCIↃ reads as C followed by CIↃ (900), never as CC followed by IↃ.
+//
+// Each of these is just another digit on the ladder I, V, X, L, C, D, M, V̅, X̅, ... (1, 5, 10, 50, ...), and numerals
+// follow the usual rules on that ladder: a power of ten repeats up to three times (M included, unlike in rome.h), a
+// five never repeats, and subtractive pairs and the order of digits are as in MCMXCIX. Some digits have several
+// spellings (M, I̅, CIↃ and (I) are all 1000), and a run must spell its digit the same way throughout. Apostrophus glyphs
+// are accepted anywhere. Powers of a thousand are only spelled as M in a leading run and as the ten of a nine (MMM,
+// CM, M̅M̅), and as an overlined I elsewhere (I̅V̅, X̅I̅I̅), so each value has one vinculum spelling: the one
+// rome_format_extended writes. I̅ alone, or I̅ followed by a lower digit, is rejected, since M spells it.
+// Parsing takes time linear in the length of the numeral, which stays short however large its value is.
+//
+// ROME_DIALECT_EXTENDED (see context.h) accepts exactly the numerals of ROME_NOTATION_VINCULUM_ASCII with at most one
+// underscore per digit, which are those below 4,000,000, through the DFA engine's tables and as an int. Larger values,
+// the other notations and 64-bit results are only available here; the "extended" check (see check.c) keeps the two in
+// agreement.
+
+enum rome_notation {
+    ROME_NOTATION_VINCULUM,          // Combining overlines: I̅V̅ is 4000
+    ROME_NOTATION_VINCULUM_ASCII,    // Leading underscores: _I_V is 4000
+    ROME_NOTATION_APOSTROPHUS,       // CIↃIↃↃ is 4000. Digits below 1000 are the usual ones.
+    ROME_NOTATION_APOSTROPHUS_ASCII, // (I)I)) is 4000
+};
+
+// Parses the len bytes at ptr as a numeral in any of the notations above (or a mix of them), into *value.
+// Returns ROME_OK, or why it was rejected. Values that do not fit in 63 bits are ROME_ERROR_OVERFLOW.
+enum rome_error_kind rome_parse_extended(char const* ptr, size_t len, int64_t* value);
+
+// Writes the canonical numeral for value in the given notation to out, null-terminated.
+// Below 4000, the vinculum notations write the same numerals as format_roman; from there on, the thousands are
+// overlined (4000 is I̅V̅, 1,000,000 is M̅). Returns the length in bytes, or -1 if value is not positive or len bytes are
+// not enough. ROME_EXTENDED_MAX bytes are always enough.
+int rome_format_extended(int64_t value, enum rome_notation notation, char* out, size_t len);
+
+// Longest output of rome_format_extended, terminator included
+#define ROME_EXTENDED_MAX 2304
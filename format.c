@@ -0,0 +1,105 @@
+#include <string.h>
+
+#include "roman_table.h"
+#include "rome.h"
+
+/*
+ * Every decimal digit below the thousands is spelled independently of the others, with at most four characters. The
+ * spellings are precomputed below, padded to four bytes, so a numeral is written as a run of M followed by three
+ * fixed-width 4-byte stores. Each store may write up to three bytes of padding past the end of its group, which the
+ * next store (or the caller's slack) absorbs.
+ */
+
+struct digit_group {
+    char text[4];  // Spelling, padded with zeros (not null-terminated when it is four characters long)
+    unsigned char len;
+};
+
+// digit_groups[p][d] is the spelling of digit d at position p (0 = units, 1 = tens, 2 = hundreds)
+static const struct digit_group digit_groups[3][10] = {
+    {{"", 0}, {"I", 1}, {"II", 2}, {"III", 3}, {"IV", 2}, {"V", 1}, {"VI", 2}, {"VII", 3}, {"VIII", 4}, {"IX", 2}},
+    {{"", 0}, {"X", 1}, {"XX", 2}, {"XXX", 3}, {"XL", 2}, {"L", 1}, {"LX", 2}, {"LXX", 3}, {"LXXX", 4}, {"XC", 2}},
+    {{"", 0}, {"C", 1}, {"CC", 2}, {"CCC", 3}, {"CD", 2}, {"D", 1}, {"DC", 2}, {"DCC", 3}, {"DCCC", 4}, {"CM", 2}},
+};
+
+// Bytes that may be written past the end of the last numeral
+enum { SLACK = 3 };
+
+// Length of the numeral for a positive value
+static size_t numeral_length(const int value) {
+    return (size_t)(value / 1000)
+        + digit_groups[2][value / 100 % 10].len
+        + digit_groups[1][value / 10 % 10].len
+        + digit_groups[0][value % 10].len;
+}
+
+// Writes the numeral for a positive value to out, which must have room for numeral_length(value) + SLACK bytes.
+// Returns the numeral length.
+static size_t write_groups(const int value, char* const out) {
+    size_t pos = (size_t)(value / 1000);
+    memset(out, 'M', pos);
+
+    const int digits[3] = {value / 100 % 10, value / 10 % 10, value % 10};
+    for (int i = 0; i < 3; ++i) {
+        struct digit_group const* const g = &digit_groups[2 - i][digits[i]];
+        memcpy(out + pos, g->text, sizeof(g->text));
+        pos += g->len;
+    }
+    return pos;
+}
+
+int format_roman(const int value, char* const out, const size_t len) {
+    if (value <= 0 || len == 0) {
+        return -1;
+    }
+
+    if (value <= ROMAN_TABLE_MAX) {
+        // One indexed copy from the generated table
+        const uint32_t begin = roman_table_offsets[value];
+        const size_t n = roman_table_offsets[value + 1] - begin;
+        if (n + 1 > len) {
+            return -1;
+        }
+        memcpy(out, roman_table_text + begin, n);
+        out[n] = '\0';
+        return (int)n;
+    }
+
+    const size_t n = numeral_length(value);
+    if (n + 1 > len) {
+        return -1;
+    }
+
+    if (n + SLACK + 1 <= len) {
+        write_groups(value, out);
+    } else {
+        // Too tight for the padded stores: go through a scratch buffer for the last groups
+        char tail[12 + SLACK];
+        const size_t ms = (size_t)(value / 1000);
+        memset(out, 'M', ms);
+        write_groups(value % 1000, tail);
+        memcpy(out + ms, tail, n - ms);
+    }
+    out[n] = '\0';
+    return (int)n;
+}
+
+size_t format_roman_batch_size(int32_t const* const vals, const size_t n) {
+    size_t total = SLACK;
+    for (size_t i = 0; i < n; ++i) {
+        total += vals[i] > 0 ? numeral_length(vals[i]) : 0;
+    }
+    return total;
+}
+
+size_t format_roman_batch(int32_t const* const vals, const size_t n, char* const out, uint32_t* const offsets) {
+    size_t pos = 0;
+    for (size_t i = 0; i < n; ++i) {
+        offsets[i] = (uint32_t)pos;
+        if (vals[i] > 0) {
+            pos += write_groups(vals[i], out + pos);
+        }
+    }
+    offsets[n] = (uint32_t)pos;
+    return pos;
+}
@@ -0,0 +1,397 @@
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Build-time generator for the parser of the generated engine (see generated.h).
+ *
+ * It reads a grammar (rome.grammar): the digits, the tokens they make up, and which tokens may follow which. Every
+ * spelling of a token is a string of digits (C+ is C, CC and CCC), so the grammar is a nondeterministic automaton over
+ * digits, whose positions are "k digits into this spelling of this token". The subset construction turns it into a
+ * DFA, and the DFA is written out as C: one label per state, holding a switch over the next byte whose cases add the
+ * digit's value and jump to the next state. Nothing is looked up at run time, and every branch is specialized to its
+ * state, so the compiler is free to lay out the common paths (MMXXIV) as straight-line code.
+ *
+ * Every state of the DFA is reached by one digit only, so the value of a transition does not depend on the grammar:
+ * the digit, minus twice the previous digit if that one is smaller (IV adds 1, then 5-2), as in dfa.c.
+ *
+ * Usage: gen_parser <grammar> <output.c>
+ */
+
+enum {
+    MAX_DIGITS = 16,
+    MAX_TOKENS = 64,
+    MAX_NAME = 8,         // Longest token name
+    MAX_ALTERNATIVES = 3, // Spellings of an A+ token
+    MAX_POSITIONS = 256,
+    MAX_STATES = 256,
+    MAX_PREFIX = 32,      // Longest example spelling shown in the comments
+};
+
+enum { SET_WORDS = MAX_POSITIONS / 64 };
+
+struct digit {
+    char c;
+    int value;
+};
+
+struct rule {
+    char name[MAX_NAME + 1];
+    char spellings[MAX_ALTERNATIVES][MAX_NAME + 1];
+    int alternatives;
+    bool loop;    // A*: may be followed by itself
+    bool defined; // Has a rule of its own (the start does too)
+    int follows[MAX_TOKENS];
+    int follow_count;
+};
+
+// A position of the nondeterministic automaton: length digits into a spelling of a token
+struct position {
+    int token;
+    int alternative;
+    int length;
+};
+
+// A state of the DFA: a set of positions, all of them reached by the same digit
+struct state {
+    uint64_t positions[SET_WORDS];
+    int digit; // Index of the digit it is reached by, or -1 for the start
+    char prefix[MAX_PREFIX + 1];
+    int next[MAX_DIGITS]; // -1 where the numeral is rejected
+};
+
+static struct digit digits[MAX_DIGITS];
+static int digit_count;
+
+// Token 0 is the start: its only spelling is empty, so its only position has already read the whole token
+static struct rule rules[MAX_TOKENS] = {{.name = "start", .spellings = {""}, .alternatives = 1}};
+static int rule_count = 1;
+
+static struct position positions[MAX_POSITIONS];
+static int position_count;
+
+static struct state states[MAX_STATES];
+static int state_count;
+
+static bool check_tokenizer;
+
+static int find_digit(const char c) {
+    for (int i = 0; i < digit_count; ++i) {
+        if (digits[i].c == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Returns the token of that name, adding it if needed, or -1 if the name is not a token
+static int find_token(char const* const name) {
+    for (int i = 0; i < rule_count; ++i) {
+        if (strcmp(rules[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    const size_t len = strlen(name);
+    if (len == 0 || len > MAX_NAME || rule_count == MAX_TOKENS) {
+        return -1;
+    }
+    struct rule* const r = &rules[rule_count];
+    *r = (struct rule) {0};
+    strcpy(r->name, name);
+    const char last = name[len - 1];
+    if ((last == '+' || last == '*') && len == 2 && find_digit(name[0]) >= 0) {
+        r->alternatives = last == '+' ? MAX_ALTERNATIVES : 1;
+        for (int i = 0; i < r->alternatives; ++i) {
+            memset(r->spellings[i], name[0], (size_t)i + 1);
+        }
+        r->loop = last == '*';
+        return rule_count++;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        if (find_digit(name[i]) < 0) {
+            return -1;
+        }
+    }
+    strcpy(r->spellings[0], name);
+    r->alternatives = 1;
+    return rule_count++;
+}
+
+// Reads the grammar. Returns false after saying what is wrong with it.
+static bool read_grammar(char const* const path) {
+    FILE* const f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[512];
+    int number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        ++number;
+        line[strcspn(line, "#\n")] = '\0';
+        char* words[MAX_TOKENS + 1];
+        int count = 0;
+        for (char* w = strtok(line, " \t\r"); w != NULL && count <= MAX_TOKENS; w = strtok(NULL, " \t\r")) {
+            words[count++] = w;
+        }
+        if (count == 0) {
+            continue;
+        }
+        if (count > MAX_TOKENS) {
+            fprintf(stderr, "gen_parser: %s:%d: too many words\n", path, number);
+            ok = false;
+        } else if (strcmp(words[0], "digits") == 0) {
+            for (int i = 1; i < count && ok; ++i) {
+                char c;
+                int value;
+                char extra;
+                if (sscanf(words[i], "%c=%d%c", &c, &value, &extra) != 2 || !isupper((unsigned char)c) || value <= 0
+                    || find_digit(c) >= 0 || digit_count == MAX_DIGITS) {
+                    fprintf(stderr, "gen_parser: %s:%d: bad digit: %s\n", path, number, words[i]);
+                    ok = false;
+                } else {
+                    digits[digit_count++] = (struct digit) {.c = c, .value = value};
+                }
+            }
+        } else if (strcmp(words[0], "check") == 0) {
+            if (count != 2 || strcmp(words[1], "tokenizer") != 0) {
+                fprintf(stderr, "gen_parser: %s:%d: can only check against the tokenizer\n", path, number);
+                ok = false;
+            }
+            check_tokenizer = true;
+        } else {
+            const int t = find_token(words[0]);
+            if (t < 0 || rules[t].defined) {
+                fprintf(stderr, "gen_parser: %s:%d: bad or repeated token: %s\n", path, number, words[0]);
+                ok = false;
+                continue;
+            }
+            rules[t].defined = true;
+            for (int i = 1; i < count && ok; ++i) {
+                const int follower = find_token(words[i]);
+                if (follower <= 0) {
+                    fprintf(stderr, "gen_parser: %s:%d: bad token: %s\n", path, number, words[i]);
+                    ok = false;
+                } else {
+                    rules[t].follows[rules[t].follow_count++] = follower;
+                }
+            }
+        }
+    }
+    fclose(f);
+
+    for (int t = 0; t < rule_count && ok; ++t) {
+        if (!rules[t].defined) {
+            fprintf(stderr, "gen_parser: %s: no rule for %s\n", path, rules[t].name);
+            ok = false;
+        }
+        if (rules[t].loop) {
+            rules[t].follows[rules[t].follow_count++] = t;
+        }
+    }
+    return ok;
+}
+
+static void add_position(const int token, const int alternative, const int length) {
+    positions[position_count++] = (struct position) {.token = token, .alternative = alternative, .length = length};
+}
+
+// Numbers the positions: the start's, then 1..len digits into every spelling of every token
+static bool number_positions(void) {
+    add_position(0, 0, 0);
+    for (int t = 1; t < rule_count; ++t) {
+        for (int a = 0; a < rules[t].alternatives; ++a) {
+            const int len = (int)strlen(rules[t].spellings[a]);
+            if (position_count + len > MAX_POSITIONS) {
+                fprintf(stderr, "gen_parser: more than %d positions\n", MAX_POSITIONS);
+                return false;
+            }
+            for (int k = 1; k <= len; ++k) {
+                add_position(t, a, k);
+            }
+        }
+    }
+    return true;
+}
+
+static int position_of(const int token, const int alternative, const int length) {
+    for (int p = 0; p < position_count; ++p) {
+        if (positions[p].token == token && positions[p].alternative == alternative && positions[p].length == length) {
+            return p;
+        }
+    }
+    abort();
+}
+
+static bool contains(uint64_t const* const set, const int p) {
+    return (set[p / 64] >> (p % 64)) & 1;
+}
+
+// Where the positions in from go on digit c
+static void step(uint64_t const* const from, const char c, uint64_t* const to) {
+    memset(to, 0, SET_WORDS * sizeof(*to));
+    for (int p = 0; p < position_count; ++p) {
+        if (!contains(from, p)) {
+            continue;
+        }
+        struct rule const* const r = &rules[positions[p].token];
+        char const* const spelling = r->spellings[positions[p].alternative];
+        const int k = positions[p].length;
+        if (spelling[k] != '\0') {
+            if (spelling[k] == c) {
+                const int q = position_of(positions[p].token, positions[p].alternative, k + 1);
+                to[q / 64] |= 1ull << (q % 64);
+            }
+            continue;
+        }
+        // The token is complete: go on with the first digit of a follower
+        for (int i = 0; i < r->follow_count; ++i) {
+            struct rule const* const f = &rules[r->follows[i]];
+            for (int a = 0; a < f->alternatives; ++a) {
+                if (f->spellings[a][0] == c) {
+                    const int q = position_of(r->follows[i], a, 1);
+                    to[q / 64] |= 1ull << (q % 64);
+                }
+            }
+        }
+    }
+}
+
+static bool accepting(struct state const* const s) {
+    for (int p = 1; p < position_count; ++p) {
+        char const* const spelling = rules[positions[p].token].spellings[positions[p].alternative];
+        if (contains(s->positions, p) && spelling[positions[p].length] == '\0') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The subset construction, breadth first so that the prefix of each state is its shortest spelling
+static bool build_states(void) {
+    states[0] = (struct state) {.digit = -1};
+    states[0].positions[0] = 1;
+    state_count = 1;
+
+    for (int s = 0; s < state_count; ++s) {
+        for (int d = 0; d < digit_count; ++d) {
+            uint64_t to[SET_WORDS];
+            step(states[s].positions, digits[d].c, to);
+            states[s].next[d] = -1;
+            bool empty = true;
+            for (int w = 0; w < SET_WORDS; ++w) {
+                empty &= to[w] == 0;
+            }
+            if (empty) {
+                continue;
+            }
+
+            int t = 0;
+            while (t < state_count && memcmp(states[t].positions, to, sizeof(to)) != 0) {
+                ++t;
+            }
+            if (t == state_count) {
+                if (state_count == MAX_STATES) {
+                    fprintf(stderr, "gen_parser: more than %d states\n", MAX_STATES);
+                    return false;
+                }
+                struct state* const n = &states[state_count++];
+                memcpy(n->positions, to, sizeof(to));
+                n->digit = d;
+                const size_t len = strlen(states[s].prefix);
+                memcpy(n->prefix, states[s].prefix, len);
+                if (len < MAX_PREFIX) {
+                    n->prefix[len] = digits[d].c;
+                }
+            }
+            states[s].next[d] = t;
+        }
+    }
+    return true;
+}
+
+static void write_parser(FILE* const out, char const* const grammar) {
+    fprintf(out, "// Generated by gen_parser from %s. Do not edit.\n\n", grammar);
+    fprintf(out, "#include <stdint.h>\n\n#include \"generated.h\"\n\n");
+    fprintf(out, "const bool generated_matches_tokenizer = %s;\n\n", check_tokenizer ? "true" : "false");
+    fprintf(out, "bool generated_parse(char const* const ptr, const size_t len, int* const value) {\n");
+    fprintf(out, "    char const* it = ptr;\n");
+    fprintf(out, "    char const* const end = ptr + len;\n");
+    fprintf(out, "    int64_t sum = 0;\n");
+
+    for (int s = 0; s < state_count; ++s) {
+        struct state const* const st = &states[s];
+        const int last = st->digit < 0 ? 0 : digits[st->digit].value;
+        // Nothing goes back to the start, so it needs no label
+        if (s == 0) {
+            fprintf(out, "\n    // start\n");
+        } else {
+            fprintf(out, "\ns%d: // %s\n", s, st->prefix);
+        }
+        fprintf(out, "    if (it == end) {\n");
+        if (accepting(st)) {
+            fprintf(out, "        goto accept;\n");
+        } else {
+            fprintf(out, "        return false;\n");
+        }
+        fprintf(out, "    }\n");
+        bool ends = true;
+        for (int d = 0; d < digit_count; ++d) {
+            ends &= st->next[d] < 0;
+        }
+        if (ends) {
+            fprintf(out, "    return false;\n");
+            continue;
+        }
+        fprintf(out, "    switch (*it++) {\n");
+        for (int d = 0; d < digit_count; ++d) {
+            if (st->next[d] < 0) {
+                continue;
+            }
+            const int value = digits[d].value;
+            fprintf(out, "        case '%c':\n", digits[d].c);
+            fprintf(out, "            sum += %d;\n", value - (last < value ? 2 * last : 0));
+            fprintf(out, "            goto s%d;\n", st->next[d]);
+        }
+        fprintf(out, "        default:\n");
+        fprintf(out, "            return false;\n");
+        fprintf(out, "    }\n");
+    }
+
+    fprintf(out, "\naccept:\n");
+    fprintf(out, "    if (sum > INT32_MAX) {\n");
+    fprintf(out, "        return false;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    *value = (int)sum;\n");
+    fprintf(out, "    return true;\n");
+    fprintf(out, "}\n");
+}
+
+int main(const int argc, char const* const* const argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <grammar> <output.c>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!read_grammar(argv[1]) || !number_positions() || !build_states()) {
+        return EXIT_FAILURE;
+    }
+
+    FILE* const out = fopen(argv[2], "w");
+    if (out == NULL) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+    // Name the grammar, not the path it was read from, so that the output does not depend on the build directory
+    char const* const slash = strrchr(argv[1], '/');
+    write_parser(out, slash != NULL ? slash + 1 : argv[1]);
+    fclose(out);
+
+    return EXIT_SUCCESS;
+}
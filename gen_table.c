@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roman_table.h"
+#include "token.h"
+
+/*
+ * Build-time generator for the table of canonical numerals 1..3999.
+ *
+ * Rather than trusting a formatter, it enumerates every token sequence the tokenizer rules allow (valid_pair,
+ * valid_repeats and valid_sequence) and records the spelling of each value. Since canonical numerals are unique, every
+ * value in range must be reached exactly once; the generator fails the build otherwise.
+ *
+ * Usage: gen_table <output.c> <output.bin>
+ */
+
+enum { MAX_TOKENS = 32, MAX_SPELLING = 16 };
+
+static struct token tokens[MAX_TOKENS];
+static int token_count;
+
+static char spellings[ROMAN_TABLE_MAX + 1][MAX_SPELLING];
+static int errors;
+
+// Collects every token valid_pair and valid_repeats accept, with at most three M so values stay in range
+static void collect_tokens(void) {
+    static const int digits[] = {1, 5, 10, 50, 100, 500, 1000};
+    const int n = (int)(sizeof(digits) / sizeof(digits[0]));
+
+    for (int i = 0; i < n; ++i) {
+        for (int count = 1; count <= 3; ++count) {
+            if (valid_repeats(digits[i], count)) {
+                tokens[token_count++] = (struct token) {.type = REPEAT, .digit = digits[i], .count = count};
+            }
+        }
+        for (int j = i + 1; j < n; ++j) {
+            if (valid_pair(digits[i], digits[j])) {
+                tokens[token_count++] = (struct token) {.type = PAIR, .prefix = digits[i], .suffix = digits[j]};
+            }
+        }
+    }
+}
+
+// Extends the spelling in buff (of length len, worth value) with every token allowed after prev
+static void enumerate(char* const buff, const int len, const int value, struct token const* const prev) {
+    if (value > 0) {
+        if (value > ROMAN_TABLE_MAX) {
+            return;
+        }
+        if (spellings[value][0] != '\0') {
+            fprintf(stderr, "gen_table: %d is spelled both %s and %.*s\n", value, spellings[value], len, buff);
+            ++errors;
+            return;
+        }
+        memcpy(spellings[value], buff, (size_t)len);
+    }
+
+    for (int i = 0; i < token_count; ++i) {
+        if (prev != NULL && !valid_sequence(*prev, tokens[i])) {
+            continue;
+        }
+        char text[8];
+        sprint_token(text, sizeof(text), tokens[i]);
+        const int n = (int)strlen(text);
+        if (len + n >= MAX_SPELLING) {
+            continue;
+        }
+        memcpy(buff + len, text, (size_t)n);
+        enumerate(buff, len + n, value + token_value(tokens[i]), &tokens[i]);
+    }
+}
+
+static void put_u32(FILE* const f, const uint32_t x) {
+    const unsigned char bytes[4] = {x & 0xff, (x >> 8) & 0xff, (x >> 16) & 0xff, (x >> 24) & 0xff};
+    fwrite(bytes, 1, sizeof(bytes), f);
+}
+
+int main(const int argc, char const* const* const argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <output.c> <output.bin>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    collect_tokens();
+    char buff[MAX_SPELLING];
+    enumerate(buff, 0, 0, NULL);
+
+    static uint32_t offsets[ROMAN_TABLE_MAX + 2];
+    uint32_t size = 0;
+    for (int v = 1; v <= ROMAN_TABLE_MAX; ++v) {
+        if (spellings[v][0] == '\0') {
+            fprintf(stderr, "gen_table: %d has no spelling\n", v);
+            ++errors;
+        }
+        offsets[v] = size;
+        size += (uint32_t)strlen(spellings[v]);
+    }
+    offsets[ROMAN_TABLE_MAX + 1] = size;
+
+    if (errors != 0) {
+        return EXIT_FAILURE;
+    }
+
+    FILE* const src = fopen(argv[1], "w");
+    if (src == NULL) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    fprintf(src, "// Generated by gen_table from the tokenizer rules. Do not edit.\n\n");
+    fprintf(src, "#include \"roman_table.h\"\n\n");
+    fprintf(src, "const uint32_t roman_table_offsets[ROMAN_TABLE_MAX + 2] = {\n");
+    for (int v = 0; v <= ROMAN_TABLE_MAX + 1; ++v) {
+        const bool last = v % 16 == 15 || v == ROMAN_TABLE_MAX + 1;
+        fprintf(src, "%s%u,%s", v % 16 == 0 ? "    " : "", offsets[v], last ? "\n" : " ");
+    }
+    fprintf(src, "};\n\nconst char roman_table_text[] =");
+    for (int v = 1; v <= ROMAN_TABLE_MAX; ++v) {
+        fprintf(src, "%s\"%s\"", v % 8 == 1 ? "\n    " : " ", spellings[v]);
+    }
+    fprintf(src, ";\n");
+    fclose(src);
+
+    FILE* const bin = fopen(argv[2], "wb");
+    if (bin == NULL) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+    fwrite(ROMAN_TABLE_MAGIC, 1, 8, bin);
+    put_u32(bin, ROMAN_TABLE_MAX);
+    put_u32(bin, size);
+    for (int v = 0; v <= ROMAN_TABLE_MAX + 1; ++v) {
+        put_u32(bin, offsets[v]);
+    }
+    for (int v = 1; v <= ROMAN_TABLE_MAX; ++v) {
+        fwrite(spellings[v], 1, strlen(spellings[v]), bin);
+    }
+    fclose(bin);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Internal header: the parser gen_parser generates from rome.grammar at build time (see gen_parser.c).
+
+// Parses the len bytes at ptr and writes their value to *value.
+// Returns false if they are not a numeral of the grammar or the value does not fit in an int. It never allocates.
+bool generated_parse(char const* ptr, size_t len, int* value);
+
+// Whether the grammar asks rome_check to check that generated_parse accepts the same numerals as the tokenizer
+extern const bool generated_matches_tokenizer;
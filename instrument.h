@@ -0,0 +1,111 @@
+#pragma once
+
+// Hot-path instrumentation behind stats.h: rejection counters (ROME_STATS) and latency histograms (ROME_LATENCY).
+// Everything here compiles to nothing when both are off.
+
+#include <stdint.h>
+
+#include "result.h"
+#include "stats.h"
+
+#if ROME_STATS || ROME_LATENCY
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// The counters of one thread. Only that thread writes them, so updates are a plain load and store; they are atomic
+// only so that snapshots can read them meanwhile.
+struct stats_slot {
+    _Alignas(64) _Atomic unsigned long long rejections[ROME_ERROR_KINDS];
+#if ROME_LATENCY
+    _Atomic unsigned long long ticks[2][ROME_HISTOGRAM_BUCKETS];     // By whether the call was rejected
+    _Atomic unsigned long long lengths[ROME_HISTOGRAM_BUCKETS];      // Input lengths
+    _Atomic unsigned long long length_ticks[ROME_HISTOGRAM_BUCKETS]; // Ticks spent on each length bucket
+#endif
+    _Atomic bool in_use;     // Owned by a live thread
+    struct stats_slot* next; // Slots are never freed, so the list only grows
+};
+
+// This thread's slot. NULL until the thread first records something.
+extern _Thread_local struct stats_slot* thread_stats;
+
+// Finds a slot for this thread and sets thread_stats. Returns NULL if there is no memory.
+struct stats_slot* claim_thread_stats(void);
+
+static inline struct stats_slot* get_thread_stats(void) {
+    struct stats_slot* const s = thread_stats;
+    return __builtin_expect(s != NULL, 1) ? s : claim_thread_stats();
+}
+
+static inline void bump(_Atomic unsigned long long* const counter, const unsigned long long n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+#endif
+
+// Counts a rejected input for rome_stats_snapshot.
+static inline void count_rejection(const enum rome_error_kind kind) {
+#if ROME_STATS
+    struct stats_slot* const s = get_thread_stats();
+    if (s != NULL) {
+        bump(&s->rejections[kind], 1);
+    }
+#else
+    (void)kind;
+#endif
+}
+
+// Bucket of a value in a log-linear histogram (see struct rome_histogram)
+static inline int histogram_bucket(const uint64_t value) {
+    if (value < ROME_HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+    const int shift = 63 - __builtin_clzll(value) - ROME_HISTOGRAM_SUB_BITS;
+    return (shift + 1) * ROME_HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) & (ROME_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+#if ROME_LATENCY
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif !defined(__aarch64__)
+#include <time.h>
+#endif
+
+// A timestamp in ticks (see rome_ticks_per_ns)
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+#endif
+
+// Starts timing a call. Returns zero when latency is not recorded.
+static inline uint64_t latency_start(void) {
+#if ROME_LATENCY
+    return read_ticks();
+#else
+    return 0;
+#endif
+}
+
+// Records a call that started at start, on an input of len bytes.
+static inline void latency_record(const uint64_t start, const size_t len, const bool rejected) {
+#if ROME_LATENCY
+    const uint64_t ticks = read_ticks() - start;
+    struct stats_slot* const s = get_thread_stats();
+    if (s != NULL) {
+        const int length = histogram_bucket(len);
+        bump(&s->ticks[rejected][histogram_bucket(ticks)], 1);
+        bump(&s->lengths[length], 1);
+        bump(&s->length_ticks[length], ticks);
+    }
+#else
+    (void)start, (void)len, (void)rejected;
+#endif
+}
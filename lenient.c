@@ -0,0 +1,50 @@
+#include "lenient.h"
+#include "probes.h"
+
+/*
+ * Historical sources are full of numerals the strict rules reject: IIII on clocks, VIIII and MDCCCCX in older
+ * inscriptions, IC for 99. They are read here the way they were meant: every digit is added up, except those followed
+ * by a larger digit, which are subtracted. This takes a single pass with one digit of lookahead, and a canonical
+ * numeral gets the same value as from the strict engines.
+ */
+
+// Value of each roman digit; 0 for other bytes
+static const int digit_values[256] = {
+    ['I'] = 1, ['V'] = 5, ['X'] = 10, ['L'] = 50, ['C'] = 100, ['D'] = 500, ['M'] = 1000,
+};
+
+static bool reject(struct scan_error* const err, const enum rome_error_kind kind, const int offset, const int length) {
+    *err = (struct scan_error) {.kind = kind, .offset = offset, .length = length};
+    ROME_PROBE3(reject, (int)kind, offset, length);
+    return false;
+}
+
+bool lenient_numeral(char const* const str, char const* const end, int* const value, struct scan_error* const err) {
+    if (str == end) {
+        return reject(err, ROME_ERROR_EMPTY, 0, 0);
+    }
+
+    // Each digit is added or subtracted once the next one is known. The total is always positive: of any increasing
+    // run of digits, only the last one is added, and it is larger than all the smaller digits put together.
+    int tally = 0;
+    int prev = digit_values[(unsigned char)*str];
+    if (prev == 0) {
+        return reject(err, ROME_ERROR_BAD_CHARACTER, 0, 1);
+    }
+    for (char const* it = str + 1; it != end; ++it) {
+        const int digit = digit_values[(unsigned char)*it];
+        if (digit == 0) {
+            return reject(err, ROME_ERROR_BAD_CHARACTER, (int)(it - str), 1);
+        }
+        if (__builtin_add_overflow(tally, prev < digit ? -prev : prev, &tally)) {
+            return reject(err, ROME_ERROR_OVERFLOW, 0, (int)(end - str));
+        }
+        prev = digit;
+    }
+    if (__builtin_add_overflow(tally, prev, &tally)) {
+        return reject(err, ROME_ERROR_OVERFLOW, 0, (int)(end - str));
+    }
+
+    *value = tally;
+    return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "token.h"
+
+// Internal header: the lenient engine (see lenient.c).
+
+// Reads the numeral in [str, end), canonical or not, and writes its value to *value.
+// Returns false if it is empty, holds something other than roman digits, or does not fit in an int, in which case err
+// says why (relative to str). It never allocates.
+bool lenient_numeral(char const* str, char const* end, int* value, struct scan_error* err);
@@ -0,0 +1,62 @@
+#include "lines.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void lines_init(struct line_splitter* const s) {
+    *s = (struct line_splitter) {.carry = NULL, .len = 0, .capacity = 0};
+}
+
+// Appends n bytes to the carry-over buffer
+static bool carry(struct line_splitter* const s, char const* const data, const size_t n) {
+    if (n == 0) {
+        return true;
+    }
+    if (s->len + n > s->capacity) {
+        size_t capacity = s->capacity ? s->capacity : 256;
+        while (capacity < s->len + n) {
+            capacity *= 2;
+        }
+        char* const grown = realloc(s->carry, capacity);
+        if (grown == NULL) {
+            return false;
+        }
+        s->carry = grown;
+        s->capacity = capacity;
+    }
+    memcpy(s->carry + s->len, data, n);
+    s->len += n;
+    return true;
+}
+
+bool lines_feed(struct line_splitter* const s, char const* data, size_t n, const line_fn on_line, void* const user) {
+    char const* newline;
+    while ((newline = memchr(data, '\n', n)) != NULL) {
+        const size_t len = (size_t)(newline - data);
+        if (s->len > 0) {
+            // The line started in an earlier block
+            if (!carry(s, data, len)) {
+                return false;
+            }
+            on_line(user, s->carry, s->len);
+            s->len = 0;
+        } else {
+            on_line(user, data, len);
+        }
+        data += len + 1;
+        n -= len + 1;
+    }
+    return carry(s, data, n);
+}
+
+void lines_finish(struct line_splitter* const s, const line_fn on_line, void* const user) {
+    if (s->len > 0) {
+        on_line(user, s->carry, s->len);
+        s->len = 0;
+    }
+}
+
+void lines_destroy(struct line_splitter* const s) {
+    free(s->carry);
+    lines_init(s);
+}
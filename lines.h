@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Receives one line, without its newline
+typedef void (*line_fn)(void* user, char const* line, size_t len);
+
+// Splits blocks of input into lines.
+// Lines are handed out in place whenever they are inside one block. Only a line that straddles two blocks is copied,
+// into a carry-over buffer that grows geometrically and is reused, so lines of any length cost no allocation per line.
+struct line_splitter {
+    char* carry;     // Start of a line whose end has not been seen yet
+    size_t len;      // Bytes in carry
+    size_t capacity; // Bytes allocated for carry
+};
+
+// Initializes an empty splitter.
+void lines_init(struct line_splitter* s);
+
+// Calls on_line for every line that ends within these n bytes. Returns false if the carry-over buffer cannot grow.
+bool lines_feed(struct line_splitter* s, char const* data, size_t n, line_fn on_line, void* user);
+
+// Calls on_line for the last line, if the input did not end with a newline.
+void lines_finish(struct line_splitter* s, line_fn on_line, void* user);
+
+// Releases the carry-over buffer.
+void lines_destroy(struct line_splitter* s);
@@ -0,0 +1,235 @@
+// Load generator for "rome serve" (see serve.h).
+// Keeps a number of batches in flight over one connection, checks every reply, and reports throughput and latency.
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rome.h"
+#include "serve.h"
+
+enum { FRAMES = 64 }; // Distinct requests, sent round-robin
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(void const* const a, void const* const b) {
+    const double x = *(double const*)a, y = *(double const*)b;
+    return (x > y) - (x < y);
+}
+
+// Value of the j-th numeral of frame k
+static int32_t expected(const size_t k, const size_t j, const size_t batch) {
+    return (int32_t)((k * batch + j) % 3999 + 1);
+}
+
+static bool parse_count(char const* const arg, size_t* const out) {
+    char* end;
+    const unsigned long n = strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || n == 0) {
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+static void usage(FILE* const f, char const* const argv0) {
+    fprintf(f,
+        "usage: %s --socket PATH [options]\n"
+        "Sends batches of numerals to \"rome serve\" and reports how fast they are answered.\n"
+        "\n"
+        "  --socket PATH       Where the server listens\n"
+        "  --requests N        Batches to send (default: 100000)\n"
+        "  --batch N           Numerals per batch (default: 64)\n"
+        "  --pipeline N        Batches in flight (default: 16)\n"
+        "  --help              Show this message\n",
+        argv0);
+}
+
+int main(const int argc, char* const* const argv) {
+    enum { OPT_SOCKET = 256, OPT_REQUESTS, OPT_BATCH, OPT_PIPELINE, OPT_HELP };
+    static const struct option options[] = {
+        {"socket", required_argument, NULL, OPT_SOCKET},
+        {"requests", required_argument, NULL, OPT_REQUESTS},
+        {"batch", required_argument, NULL, OPT_BATCH},
+        {"pipeline", required_argument, NULL, OPT_PIPELINE},
+        {"help", no_argument, NULL, OPT_HELP},
+        {NULL, 0, NULL, 0},
+    };
+
+    char const* path = NULL;
+    size_t requests = 100000, batch = 64, pipeline = 16;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        size_t* count = NULL;
+        switch (opt) {
+            case OPT_SOCKET:
+                path = optarg;
+                break;
+            case OPT_REQUESTS:
+                count = &requests;
+                break;
+            case OPT_BATCH:
+                count = &batch;
+                break;
+            case OPT_PIPELINE:
+                count = &pipeline;
+                break;
+            case OPT_HELP:
+                usage(stdout, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr, argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (count != NULL && !parse_count(optarg, count)) {
+            fprintf(stderr, "%s: expected a positive number: %s\n", argv[0], optarg);
+            return EXIT_FAILURE;
+        }
+    }
+    if (path == NULL || optind != argc) {
+        usage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Builds the requests up front, so that the client does as little as possible while measuring
+    size_t frame_offsets[FRAMES + 1] = {0};
+    char* const frames = malloc(FRAMES * (sizeof(uint32_t) + batch * 16));
+    const size_t reply_size = sizeof(uint32_t) + batch * sizeof(struct serve_record);
+    char* const reply = malloc(2 * reply_size);
+    double* const latencies = malloc(requests * sizeof(double));
+    double* const started = malloc(pipeline * sizeof(double));
+    if (frames == NULL || reply == NULL || latencies == NULL || started == NULL) {
+        perror(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t k = 0; k < FRAMES; ++k) {
+        char* const header = frames + frame_offsets[k];
+        char* it = header + sizeof(uint32_t);
+        for (size_t j = 0; j < batch; ++j) {
+            if (j > 0) {
+                *it++ = '\n';
+            }
+            it += format_roman(expected(k, j, batch), it, 16);
+        }
+        const uint32_t size = (uint32_t)(it - header - sizeof(uint32_t));
+        if (size > SERVE_MAX_REQUEST) {
+            fprintf(stderr, "%s: batches are limited to %d bytes\n", argv[0], SERVE_MAX_REQUEST);
+            return EXIT_FAILURE;
+        }
+        memcpy(header, &size, sizeof(size));
+        frame_offsets[k + 1] = (size_t)(it - frames);
+    }
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path is too long: %s\n", argv[0], path);
+        return EXIT_FAILURE;
+    }
+    strcpy(addr.sun_path, path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr const*)&addr, sizeof(addr)) != 0) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    size_t sent = 0, received = 0;
+    size_t frame_sent = 0; // Bytes of the current request already sent
+    size_t reply_len = 0;  // Bytes of replies received and not checked yet
+    const double start = now();
+
+    while (received < requests) {
+        const bool can_send = sent < requests && sent - received < pipeline;
+        struct pollfd p = {.fd = fd, .events = POLLIN | (can_send ? POLLOUT : 0)};
+        if (poll(&p, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            return EXIT_FAILURE;
+        }
+
+        if (p.revents & POLLOUT) {
+            while (sent < requests && sent - received < pipeline) {
+                const size_t k = sent % FRAMES;
+                if (frame_sent == 0) {
+                    started[sent % pipeline] = now();
+                }
+                const size_t size = frame_offsets[k + 1] - frame_offsets[k];
+                const ssize_t n = send(fd, frames + frame_offsets[k] + frame_sent, size - frame_sent, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                        break;
+                    }
+                    perror("send");
+                    return EXIT_FAILURE;
+                }
+                frame_sent += (size_t)n;
+                if (frame_sent < size) {
+                    break;
+                }
+                frame_sent = 0;
+                ++sent;
+            }
+        }
+
+        if (p.revents & (POLLIN | POLLHUP | POLLERR)) {
+            const ssize_t n = recv(fd, reply + reply_len, 2 * reply_size - reply_len, 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                fprintf(stderr, "%s: connection lost after %zu replies\n", argv[0], received);
+                return EXIT_FAILURE;
+            }
+            reply_len += n > 0 ? (size_t)n : 0;
+
+            // Replies all have the same size, because every numeral is answered
+            size_t pos = 0;
+            for (; reply_len - pos >= reply_size; pos += reply_size) {
+                const size_t k = received % FRAMES;
+                uint32_t count;
+                memcpy(&count, reply + pos, sizeof(count));
+                bool ok = count == batch;
+                for (size_t j = 0; ok && j < batch; ++j) {
+                    struct serve_record record;
+                    memcpy(&record, reply + pos + sizeof(uint32_t) + j * sizeof(record), sizeof(record));
+                    ok = record.kind == ROME_OK && record.value == expected(k, j, batch);
+                }
+                if (!ok) {
+                    fprintf(stderr, "%s: wrong reply to request %zu\n", argv[0], received);
+                    return EXIT_FAILURE;
+                }
+                latencies[received] = now() - started[received % pipeline];
+                ++received;
+            }
+            memmove(reply, reply + pos, reply_len - pos);
+            reply_len -= pos;
+        }
+    }
+
+    const double elapsed = now() - start;
+    close(fd);
+
+    qsort(latencies, requests, sizeof(double), compare_doubles);
+    printf("%zu requests of %zu numerals, %zu in flight, in %.3f s\n", requests, batch, pipeline, elapsed);
+    printf("%.0f requests/s, %.0f numerals/s\n", (double)requests / elapsed, (double)(requests * batch) / elapsed);
+    printf("latency: p50 %.1f us, p99 %.1f us, max %.1f us\n", latencies[requests / 2] * 1e6,
+        latencies[requests * 99 / 100] * 1e6, latencies[requests - 1] * 1e6);
+
+    free(frames);
+    free(reply);
+    free(latencies);
+    free(started);
+    return EXIT_SUCCESS;
+}
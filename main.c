@@ -1,31 +1,477 @@
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "arena.h"
+#include "columns.h"
+#include "csv.h"
+#include "lines.h"
+#include "probes.h"
+#include "reader.h"
 #include "rome.h"
 #include "result.h"
+#include "serve.h"
+#include "stats.h"
+#include "writer.h"
 
-int main() {
-    const int max_size = 255;
-    char buff[max_size];
+// How results are printed in text mode
+enum text_format {
+    TEXT_VERBOSE,   // A prompt, then "Result: <value>" or "Invalid input: <message>"
+    TEXT_BARE,      // Only the value. Invalid lines print an empty line.
+    TEXT_TSV,       // "<numeral>\t<value>". Invalid lines have an empty value.
+    TEXT_CANONICAL, // Only the canonical spelling. Invalid lines print an empty line.
+};
 
-    while (true) {
-        printf("Write a roman numeral: ");
-        if (fgets(buff, max_size, stdin) == NULL) {
+enum output {
+    OUTPUT_TEXT,   // One result per line (see text_format)
+    OUTPUT_CSV,    // The input rows, with numerals replaced by their values
+    OUTPUT_BINARY, // Columnar batches (see columns.h)
+};
+
+// Everything needed to convert a line, whichever way it was read
+struct cli {
+    struct rome_ctx ctx;
+    enum output output;
+    enum text_format text_format;
+    struct rome_csv csv;         // OUTPUT_CSV only
+    struct rome_columns columns; // OUTPUT_BINARY only
+    struct rome_arena arena;     // Error messages, which only live until the next line
+    struct writer* out;          // Text and CSV output
+    char* row;                   // Rewritten CSV row, or canonical numeral
+    size_t row_capacity;
+    bool prompt;                 // Ask for every line (verbose text from stdin only)
+    bool failed;                 // Output could not be written, or memory could not be allocated
+};
+
+#define PROMPT "Write a roman numeral: "
+
+// Makes room for size bytes in cli->row. It grows rarely, and never shrinks.
+static bool reserve_row(struct cli* const cli, const size_t size) {
+    if (cli->row_capacity >= size) {
+        return true;
+    }
+    free(cli->row);
+    cli->row_capacity = size;
+    cli->row = malloc(size);
+    return cli->row != NULL;
+}
+
+// Converts one line (without its newline) and queues its output
+static void convert_line(void* const user, char const* const line, size_t len) {
+    struct cli* const cli = user;
+    if (cli->failed) {
+        return;
+    }
+
+    switch (cli->output) {
+        case OUTPUT_TEXT: {
+            rome_arena_reset(&cli->arena);
+            const struct result res = rome_parse_n(&cli->ctx, line, len);
+            switch (cli->text_format) {
+                case TEXT_VERBOSE:
+                    if (res.error != NULL) {
+                        writer_put_str(cli->out, "Invalid input: ");
+                        writer_put_str(cli->out, res.error);
+                    } else {
+                        writer_put_str(cli->out, "Result: ");
+                        writer_put_int(cli->out, res.value);
+                    }
+                    break;
+                case TEXT_TSV:
+                    writer_put(cli->out, line, len);
+                    writer_put_char(cli->out, '\t');
+                    // Fall through
+                case TEXT_BARE:
+                    if (res.error == NULL) {
+                        writer_put_int(cli->out, res.value);
+                    }
+                    break;
+                case TEXT_CANONICAL:
+                    if (res.error == NULL) {
+                        // Dialects with overlines make values of any size out of a few bytes (_M is 1,000,000), so
+                        // size the row from the value: the thousands as M, and at most 12 bytes for the rest
+                        if (!reserve_row(cli, (size_t)res.value / 1000 + 13)) {
+                            cli->failed = true;
+                            return;
+                        }
+                        const int n = format_roman(res.value, cli->row, cli->row_capacity);
+                        if (n < 0) {
+                            errno = EOVERFLOW;
+                            cli->failed = true;
+                            return;
+                        }
+                        writer_put(cli->out, cli->row, (size_t)n);
+                    }
+                    break;
+            }
+            writer_put_char(cli->out, '\n');
+            if (cli->prompt) {
+                writer_put_str(cli->out, PROMPT);
+            }
+            return;
+        }
+        case OUTPUT_CSV: {
+            if (len > 0 && line[len - 1] == '\r') {
+                --len;
+            }
+            // Four times the row length always fits (see rome_csv_rewrite_row). Empty rows still need a buffer.
+            if (!reserve_row(cli, 4 * len + 1)) {
+                cli->failed = true;
+                return;
+            }
+            const long n = rome_csv_rewrite_row(&cli->ctx, &cli->csv, line, len, cli->row, cli->row_capacity);
+            assert(n >= 0);
+            writer_put(cli->out, cli->row, (size_t)n);
+            writer_put_char(cli->out, '\n');
+            return;
+        }
+        case OUTPUT_BINARY: {
+            const struct result res = rome_parse_n(&cli->ctx, line, len);
+            rome_columns_push(&cli->columns, res.value, res.kind);
+            if (rome_columns_full(&cli->columns)) {
+                cli->failed = !rome_columns_write(&cli->columns, stdout);
+                rome_columns_clear(&cli->columns);
+            }
+            return;
+        }
+    }
+}
+
+// Converts every line of fd, read in large blocks (see reader.h). Lines of any length are parsed whole.
+// Returns false, with a message, if it cannot be read.
+static bool read_lines(struct cli* const cli, const int fd, char const* const name, const bool use_uring) {
+    struct reader reader;
+    if (!reader_open(&reader, fd, use_uring)) {
+        perror(name);
+        return false;
+    }
+
+    struct line_splitter lines;
+    lines_init(&lines);
+
+    // Output goes out in large blocks, unless someone is watching: then it is shown before waiting for more input
+    const bool interactive = isatty(STDOUT_FILENO);
+    if (cli->prompt) {
+        writer_put_str(cli->out, PROMPT);
+    }
+
+    enum reader_status status = READER_END;
+    struct reader_block block;
+    while (!cli->failed) {
+        if (interactive) {
+            writer_flush(cli->out);
+        }
+        if ((status = reader_next(&reader, &block)) != READER_BLOCK) {
             break;
         }
+        ROME_PROBE1(read__block, block.len);
+        cli->failed = !lines_feed(&lines, block.data, block.len, convert_line, cli);
+        reader_release(&reader);
+    }
+    if (status == READER_ERROR) {
+        perror(name);
+    } else {
+        lines_finish(&lines, convert_line, cli);
+    }
+
+    lines_destroy(&lines);
+    reader_close(&reader);
+    return status != READER_ERROR;
+}
 
-        const struct result res = parse_roman_number(buff);
-        if (res.error != NULL) {
-            fprintf(stdout, "Invalid input: %s\n", res.error);
-            free_result(res);
-            continue;
+static bool read_file(struct cli* const cli, char const* const path, const bool use_uring) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    const bool ok = read_lines(cli, fd, path, use_uring);
+    close(fd);
+    return ok;
+}
+
+// Prints why inputs were rejected and, if compiled in, the latency histograms (see stats.h)
+static void report_stats(FILE* const f) {
+    const struct rome_rejections rejections = rome_stats_snapshot();
+    for (int kind = ROME_OK + 1; kind < ROME_ERROR_KINDS; ++kind) {
+        if (rejections.by_kind[kind] > 0) {
+            fprintf(f, "%llu\t%s\n", rejections.by_kind[kind], rome_error_string(kind));
         }
+    }
 
-        printf("Result: %d\n", res.value);
-        free_result(res);
+    static struct rome_latency latency;
+    if (!rome_latency_snapshot(&latency)) {
+        return;
     }
+    const double ticks_per_ns = rome_ticks_per_ns();
+    static const double percentiles[] = {50, 90, 99, 99.9, 100};
+    fprintf(f, "\nlatency (ns)\tp50\tp90\tp99\tp99.9\tmax\n");
+    for (int rejected = 0; rejected < 2; ++rejected) {
+        struct rome_histogram const* const h = rejected ? &latency.rejected : &latency.accepted;
+        fprintf(f, "%s", rejected ? "rejected" : "accepted");
+        for (size_t i = 0; i < sizeof(percentiles) / sizeof(*percentiles); ++i) {
+            fprintf(f, "\t%.0f", (double)rome_histogram_percentile(h, percentiles[i]) / ticks_per_ns);
+        }
+        fprintf(f, "\n");
+    }
+
+    fprintf(f, "\nlength (bytes)\tcalls\tmean (ns)\n");
+    for (int i = 0; i < ROME_HISTOGRAM_BUCKETS; ++i) {
+        const unsigned long long calls = latency.lengths.counts[i];
+        if (calls > 0) {
+            fprintf(f, "%llu+\t%llu\t%.1f\n", rome_histogram_floor(i), calls,
+                (double)latency.length_ticks[i] / (double)calls / ticks_per_ns);
+        }
+    }
+}
+
+// Parses a comma-separated list of column indices (e.g. "0,3") into a bitmask
+static bool parse_columns(char const* list, uint64_t* const columns) {
+    *columns = 0;
+    while (*list != '\0') {
+        char* end;
+        const unsigned long column = strtoul(list, &end, 10);
+        if (end == list || column > 63 || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        *columns |= (uint64_t)1 << column;
+        list = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+static void usage(FILE* const f, char const* const argv0) {
+    fprintf(f,
+        "usage: %s [options] [FILE]...\n"
+        "       %s serve (--socket PATH | --ring NAME [--slots N]) [--engine NAME] [--dialect NAME]\n"
+        "Converts roman numerals, one per line, read from the given files or else from stdin.\n"
+        "In serve mode, answers numerals sent over a Unix socket (see serve.h) or a shared-memory ring (see ring.h)\n"
+        "until interrupted.\n"
+        "\n"
+        "  --csv               Read delimited rows, and print them back with numerals replaced by their values\n"
+        "  --delimiters SET    Field delimiters for --csv (default: \",\")\n"
+        "  --columns LIST      Comma-separated columns holding numerals, counting from 0 (default: all)\n"
+        "  --output FORMAT     text (default), or int32 or int64 for binary columnar batches\n"
+        "  --bare              In text mode, print only the values\n"
+        "  --tsv               In text mode, print each numeral and its value, separated by a tab\n"
+        "  --canonical         In text mode, print the canonical spelling of each numeral (see --engine lenient)\n"
+        "  --engine NAME       Parsing engine: tokenizer (default), dfa, generated (from rome.grammar), or lenient to\n"
+        "                      accept non-canonical numerals\n"
+        "  --dialect NAME      Numerals to accept: strict (default), clock (IIII), medieval (IIII or IV, VIIII or IX),\n"
+        "                      lowercase, or extended (_I_V for 4000)\n"
+        "  --no-uring          Read files with read(2) even where io_uring is available\n"
+        "  --stats             When done, print to stderr how many inputs were rejected for each reason, and the\n"
+        "                      latency histograms if built with ROME_LATENCY\n"
+        "  --socket PATH       Where the server listens\n"
+        "  --ring NAME         Shared-memory object the server creates for its ring (e.g. /rome)\n"
+        "  --slots N           Slots in the ring, a power of two from 4 (default: 1024)\n"
+        "  --help              Show this message\n",
+        argv0, argv0);
 }
 
+int main(const int argc, char* const* const argv) {
+    enum { OPT_CSV = 256, OPT_DELIMITERS, OPT_COLUMNS, OPT_OUTPUT, OPT_BARE, OPT_TSV, OPT_CANONICAL, OPT_ENGINE, OPT_DIALECT,
+           OPT_NO_URING, OPT_STATS, OPT_SOCKET, OPT_RING, OPT_SLOTS, OPT_HELP };
+    static const struct option options[] = {
+        {"csv", no_argument, NULL, OPT_CSV},
+        {"delimiters", required_argument, NULL, OPT_DELIMITERS},
+        {"columns", required_argument, NULL, OPT_COLUMNS},
+        {"output", required_argument, NULL, OPT_OUTPUT},
+        {"bare", no_argument, NULL, OPT_BARE},
+        {"tsv", no_argument, NULL, OPT_TSV},
+        {"canonical", no_argument, NULL, OPT_CANONICAL},
+        {"engine", required_argument, NULL, OPT_ENGINE},
+        {"dialect", required_argument, NULL, OPT_DIALECT},
+        {"no-uring", no_argument, NULL, OPT_NO_URING},
+        {"stats", no_argument, NULL, OPT_STATS},
+        {"socket", required_argument, NULL, OPT_SOCKET},
+        {"ring", required_argument, NULL, OPT_RING},
+        {"slots", required_argument, NULL, OPT_SLOTS},
+        {"help", no_argument, NULL, OPT_HELP},
+        {NULL, 0, NULL, 0},
+    };
+
+    static struct writer out;
+    struct cli cli = {.output = OUTPUT_TEXT, .text_format = TEXT_VERBOSE, .out = &out};
+    rome_ctx_init(&cli.ctx);
+
+    bool csv_mode = false;
+    char const* delimiters = ",";
+    uint64_t columns = UINT64_MAX;
+    enum rome_value_width binary_width = 0; // Zero for text output
+    bool use_uring = true;
+    bool print_stats = false;
+    char const* socket_path = NULL;
+    char const* ring_name = NULL;
+    unsigned long slots = 1024;
+
+    // "rome serve" takes the same options
+    const bool serve_mode = argc > 1 && strcmp(argv[1], "serve") == 0;
+    int opt;
+    while ((opt = getopt_long(argc - serve_mode, argv + serve_mode, "", options, NULL)) != -1) {
+        switch (opt) {
+            case OPT_CSV:
+                csv_mode = true;
+                break;
+            case OPT_DELIMITERS:
+                delimiters = optarg;
+                break;
+            case OPT_COLUMNS:
+                if (!parse_columns(optarg, &columns)) {
+                    fprintf(stderr, "%s: invalid column list: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_OUTPUT:
+                if (strcmp(optarg, "text") == 0) {
+                    binary_width = 0;
+                } else if (strcmp(optarg, "int32") == 0) {
+                    binary_width = ROME_INT32;
+                } else if (strcmp(optarg, "int64") == 0) {
+                    binary_width = ROME_INT64;
+                } else {
+                    fprintf(stderr, "%s: unknown output format: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_BARE:
+                cli.text_format = TEXT_BARE;
+                break;
+            case OPT_TSV:
+                cli.text_format = TEXT_TSV;
+                break;
+            case OPT_CANONICAL:
+                cli.text_format = TEXT_CANONICAL;
+                break;
+            case OPT_ENGINE:
+                if (strcmp(optarg, "tokenizer") == 0) {
+                    cli.ctx.engine = ROME_ENGINE_TOKENIZER;
+                } else if (strcmp(optarg, "dfa") == 0) {
+                    cli.ctx.engine = ROME_ENGINE_DFA;
+                } else if (strcmp(optarg, "lenient") == 0) {
+                    cli.ctx.engine = ROME_ENGINE_LENIENT;
+                } else if (strcmp(optarg, "generated") == 0) {
+                    cli.ctx.engine = ROME_ENGINE_GENERATED;
+                } else {
+                    fprintf(stderr, "%s: unknown engine: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_DIALECT: {
+                static char const* const dialects[] = {
+                    [ROME_DIALECT_STRICT] = "strict",
+                    [ROME_DIALECT_CLOCK] = "clock",
+                    [ROME_DIALECT_MEDIEVAL] = "medieval",
+                    [ROME_DIALECT_LOWERCASE] = "lowercase",
+                    [ROME_DIALECT_EXTENDED] = "extended",
+                };
+                int dialect = 0;
+                while (dialect < ROME_DIALECT_CUSTOM && strcmp(optarg, dialects[dialect]) != 0) {
+                    ++dialect;
+                }
+                if (dialect == ROME_DIALECT_CUSTOM) {
+                    fprintf(stderr, "%s: unknown dialect: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                rome_ctx_set_dialect(&cli.ctx, (enum rome_dialect)dialect);
+                break;
+            }
+            case OPT_NO_URING:
+                use_uring = false;
+                break;
+            case OPT_STATS:
+                print_stats = true;
+                break;
+            case OPT_SOCKET:
+                socket_path = optarg;
+                break;
+            case OPT_RING:
+                ring_name = optarg;
+                break;
+            case OPT_SLOTS: {
+                char* end;
+                slots = strtoul(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || slots > UINT32_MAX / 2) {
+                    fprintf(stderr, "%s: invalid number of slots: %s\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case OPT_HELP:
+                usage(stdout, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (serve_mode) {
+        if ((socket_path == NULL) == (ring_name == NULL) || optind + serve_mode != argc) {
+            usage(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+        return socket_path != NULL ? serve(&cli.ctx, socket_path) : serve_ring(&cli.ctx, ring_name, (uint32_t)slots);
+    }
+    if (socket_path != NULL || ring_name != NULL) {
+        fprintf(stderr, "%s: --socket and --ring are only for serve mode\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (csv_mode && binary_width != 0) {
+        fprintf(stderr, "%s: --csv only supports text output\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    writer_init(&out, STDOUT_FILENO);
+    rome_arena_init(&cli.arena, 4096);
+    cli.ctx.allocator = &cli.arena.allocator;
+    if (binary_width != 0) {
+        cli.output = OUTPUT_BINARY;
+        if (!rome_columns_init(&cli.columns, binary_width, 1 << 16)) {
+            perror("rome");
+            return EXIT_FAILURE;
+        }
+    } else if (csv_mode) {
+        cli.output = OUTPUT_CSV;
+        rome_csv_init(&cli.csv, delimiters, columns);
+    }
+    // Only verbose text shows the messages. Otherwise nothing is allocated per line.
+    cli.ctx.format_errors = cli.output == OUTPUT_TEXT && cli.text_format == TEXT_VERBOSE;
+
+    bool ok = true;
+    if (optind == argc) {
+        // Someone may be typing, so verbose text mode prompts for every line
+        cli.prompt = cli.output == OUTPUT_TEXT && cli.text_format == TEXT_VERBOSE;
+        ok = read_lines(&cli, STDIN_FILENO, "stdin", use_uring);
+        cli.prompt = false;
+    }
+    for (int i = optind; i < argc && !cli.failed; ++i) {
+        ok &= read_file(&cli, argv[i], use_uring);
+    }
+
+    if (cli.output == OUTPUT_BINARY) {
+        if (!cli.failed && cli.columns.rows > 0) {
+            cli.failed = !rome_columns_write(&cli.columns, stdout);
+        }
+        cli.failed |= fflush(stdout) != 0;
+        rome_columns_destroy(&cli.columns);
+    }
+    cli.failed |= !writer_flush(&out);
+    if (cli.failed) {
+        perror("rome");
+    }
+
+    if (print_stats) {
+        report_stats(stderr);
+    }
+
+    free(cli.row);
+    rome_arena_destroy(&cli.arena);
+    return ok && !cli.failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
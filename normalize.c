@@ -0,0 +1,29 @@
+#include "lenient.h"
+#include "rome.h"
+
+/*
+ * Normalization reads a numeral with the lenient engine, then writes the value back with the formatter. Both are
+ * single passes, so a catalogue of historical spellings is cleaned without parsing anything twice.
+ */
+
+enum rome_error_kind rome_normalize(char const* const ptr, const size_t len, int* const value, char* const out,
+                                    const size_t outlen) {
+    int tally;
+    struct scan_error err;
+    if (!lenient_numeral(ptr, ptr + len, &tally, &err)) {
+        return err.kind;
+    }
+    if (value != NULL) {
+        *value = tally;
+    }
+    return format_roman(tally, out, outlen) < 0 ? ROME_ERROR_NO_SPACE : ROME_OK;
+}
+
+void rome_normalize_batch(struct rome_span const* const numerals, const size_t n, char* const out, const size_t stride,
+                          int32_t* const values, enum rome_error_kind* const kinds) {
+    for (size_t i = 0; i < n; ++i) {
+        int value = 0;
+        kinds[i] = rome_normalize(numerals[i].ptr, numerals[i].len, &value, out + i * stride, stride);
+        values[i] = value;
+    }
+}
@@ -0,0 +1,34 @@
+# Runs an instrumented rome over the training corpus and leaves a profile to build with (see ROME_PGO in
+# CMakeLists.txt). Run with cmake -P, defining:
+#   ROME         the instrumented rome
+#   CORPUS       the training corpus, one numeral per line
+#   PROFILE_DIR  the directory the instrumented rome writes its counters to
+#   PROFDATA     llvm-profdata, for Clang builds only. The raw profiles are merged into PROFILE_DIR.profdata.
+#   STAMP        touched when the profile is ready
+
+# Counters add up across runs, so start from an empty directory to keep stale profiles out
+file(REMOVE_RECURSE ${PROFILE_DIR})
+file(MAKE_DIRECTORY ${PROFILE_DIR})
+
+# The ways rome is run in production: reporting errors, and converting columns of numerals with either engine
+foreach (ARGS "" "--bare" "--bare;--engine;dfa")
+    execute_process(
+            COMMAND ${ROME} ${ARGS} ${CORPUS}
+            OUTPUT_QUIET
+            RESULT_VARIABLE RESULT)
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Training run '${ROME} ${ARGS} ${CORPUS}' failed: ${RESULT}")
+    endif ()
+endforeach ()
+
+if (PROFDATA)
+    file(GLOB RAW_PROFILES ${PROFILE_DIR}/*.profraw)
+    execute_process(
+            COMMAND ${PROFDATA} merge -output=${PROFILE_DIR}.profdata ${RAW_PROFILES}
+            RESULT_VARIABLE RESULT)
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Could not merge the profiles in ${PROFILE_DIR}")
+    endif ()
+endif ()
+
+file(TOUCH ${STAMP})
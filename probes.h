@@ -0,0 +1,36 @@
+#pragma once
+
+// USDT static tracepoints, for tracing live processes with bpftrace, perf or SystemTap without a debug rebuild.
+//
+// A probe is a single nop plus a note in the ELF file, so it costs next to nothing until a tracer attaches. Probes are
+// compiled in where <sys/sdt.h> is available (on Debian, the systemtap-sdt-dev package), unless ROME_NO_PROBES is
+// defined (CMake option ROME_PROBES=OFF). Elsewhere they expand to nothing, and so do their arguments.
+//
+// Provider "rome". Lengths and offsets are in bytes, kinds are enum rome_error_kind. Offsets count from the start of
+// the numeral, or from the start of the stream in the push parser (see stream.h), which also leaves len at zero in
+// reject because the span at fault is not known.
+//   parse__start(ptr, len)                  rome_parse_n and parse_roman_number are called
+//   parse__end(len, value, kind)            ... and return
+//   token(offset, len, value)               a token was accepted (e.g. XC has value 90)
+//   reject(kind, offset, len)               an input is rejected: where, and the span at fault
+//   read__block(len)                        the CLI got a block of input (see reader.h)
+//   write(len)                              the CLI hands a block of output to write(2) (see writer.h)
+//
+// For example: bpftrace -e 'usdt:./rome:rome:reject { @[arg0] = count(); }'
+
+#if !defined(ROME_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define ROME_HAVE_SDT 1
+#endif
+#endif
+
+#if ROME_HAVE_SDT
+#define ROME_PROBE1(name, a) DTRACE_PROBE1(rome, name, a)
+#define ROME_PROBE2(name, a, b) DTRACE_PROBE2(rome, name, a, b)
+#define ROME_PROBE3(name, a, b, c) DTRACE_PROBE3(rome, name, a, b, c)
+#else
+#define ROME_PROBE1(name, a) ((void)0)
+#define ROME_PROBE2(name, a, b) ((void)0)
+#define ROME_PROBE3(name, a, b, c) ((void)0)
+#endif
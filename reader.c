@@ -0,0 +1,320 @@
+#include "reader.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ROME_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef ROME_HAVE_URING
+
+/*
+ * Minimal io_uring wrapper over the raw system calls, so there is no dependency on liburing. It only supports what the
+ * reader needs: queueing reads, submitting them, and reaping completions.
+ */
+struct uring {
+    int fd;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned to_submit; // Queued entries the kernel has not been told about yet
+
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+};
+
+static void uring_destroy(struct uring* const ring) {
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_map != NULL && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if (ring->sq_map != NULL) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    close(ring->fd);
+    free(ring);
+}
+
+static void* map_ring(const int fd, const size_t size, const off_t offset) {
+    void* const map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return map == MAP_FAILED ? NULL : map;
+}
+
+static struct uring* uring_create(const unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct uring* const ring = calloc(1, sizeof(struct uring));
+    if (ring == NULL) {
+        close(fd);
+        return NULL;
+    }
+    ring->fd = fd;
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_map_size = ring->cq_map_size > ring->sq_map_size ? ring->cq_map_size : ring->sq_map_size;
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_map = map_ring(fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+    if (ring->sq_map == NULL) {
+        uring_destroy(ring);
+        return NULL;
+    }
+    ring->cq_map = params.features & IORING_FEAT_SINGLE_MMAP
+        ? ring->sq_map
+        : map_ring(fd, ring->cq_map_size, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = map_ring(fd, ring->sqes_size, IORING_OFF_SQES);
+    if (ring->cq_map == NULL || ring->sqes == NULL) {
+        uring_destroy(ring);
+        return NULL;
+    }
+
+    char* const sq = ring->sq_map;
+    char* const cq = ring->cq_map;
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return ring;
+}
+
+// Queues a read of len bytes at offset into buff. It is submitted by the next uring_wait.
+static void uring_queue_read(struct uring* const ring, const int fd, void* const buff, const size_t len,
+                             const uint64_t offset, const uint64_t user_data) {
+    // There are never more reads in flight than entries, so the submission queue cannot be full
+    const unsigned tail = *ring->sq_tail;
+    const unsigned index = tail & *ring->sq_mask;
+
+    struct io_uring_sqe* const sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buff;
+    sqe->len = (unsigned)len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+
+// Submits the queued reads and waits for a completion. Returns false if io_uring_enter fails.
+static bool uring_wait(struct uring* const ring, struct io_uring_cqe* const out) {
+    while (true) {
+        const unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            *out = ring->cqes[head & *ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        const int n = (int)syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        ring->to_submit -= (unsigned)n < ring->to_submit ? (unsigned)n : ring->to_submit;
+    }
+}
+
+#else
+
+struct uring {
+    int unused;
+};
+
+static struct uring* uring_create(const unsigned entries) {
+    (void)entries;
+    return NULL;
+}
+
+static void uring_destroy(struct uring* const ring) {
+    (void)ring;
+}
+
+#endif
+
+static char* slot_buffer(struct reader const* const r, const int slot) {
+    return r->pool + (size_t)slot * READER_BLOCK_SIZE;
+}
+
+#ifdef ROME_HAVE_URING
+
+// Starts reading block b into its slot, unless it is past the end of the file
+static void issue(struct reader* const r, const uint64_t b) {
+    const int slot = (int)(b % READER_QUEUE_DEPTH);
+    const uint64_t offset = b * READER_BLOCK_SIZE; // From the start
+    r->slots[slot].offset = r->start + offset;
+    r->slots[slot].filled = 0;
+    r->slots[slot].error = 0;
+    r->slots[slot].want = offset >= r->size ? 0 : (size_t)(r->size - offset < READER_BLOCK_SIZE
+        ? r->size - offset : READER_BLOCK_SIZE);
+    r->slots[slot].busy = r->slots[slot].want > 0;
+    if (r->slots[slot].busy) {
+        uring_queue_read(r->ring, r->fd, slot_buffer(r, slot), r->slots[slot].want, r->slots[slot].offset,
+            (uint64_t)slot);
+    }
+}
+
+// Reaps one completion, re-issuing the rest of a short read
+static bool reap(struct reader* const r) {
+    struct io_uring_cqe cqe;
+    if (!uring_wait(r->ring, &cqe)) {
+        return false;
+    }
+
+    const int slot = (int)cqe.user_data;
+    if (cqe.res < 0) {
+        r->slots[slot].busy = false;
+        r->slots[slot].error = -cqe.res;
+        return true;
+    }
+
+    r->slots[slot].filled += (size_t)cqe.res;
+    if (cqe.res == 0 || r->slots[slot].filled == r->slots[slot].want) {
+        // Done, or the file was truncated while reading it
+        r->slots[slot].busy = false;
+        return true;
+    }
+
+    // Short read: ask for the rest of the block
+    const size_t filled = r->slots[slot].filled;
+    uring_queue_read(r->ring, r->fd, slot_buffer(r, slot) + filled, r->slots[slot].want - filled,
+        r->slots[slot].offset + filled, (uint64_t)slot);
+    return true;
+}
+
+#endif
+
+bool reader_open(struct reader* const r, const int fd, const bool use_uring) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+
+    // Reads are issued at absolute offsets, so start where the caller left the file (e.g. a shell that read a line)
+    struct stat st;
+    const bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    const off_t start = regular ? lseek(fd, 0, SEEK_CUR) : -1;
+    if (use_uring && start >= 0) {
+        r->ring = uring_create(READER_QUEUE_DEPTH);
+    }
+
+    const int buffers = r->ring != NULL ? READER_QUEUE_DEPTH : 1;
+    r->pool = malloc((size_t)buffers * READER_BLOCK_SIZE);
+    if (r->pool == NULL) {
+        reader_close(r);
+        return false;
+    }
+
+#ifdef ROME_HAVE_URING
+    if (r->ring != NULL) {
+        r->start = (uint64_t)start;
+        r->position = r->start;
+        r->size = start < st.st_size ? (uint64_t)(st.st_size - start) : 0;
+        for (uint64_t b = 0; b < READER_QUEUE_DEPTH; ++b) {
+            issue(r, b);
+        }
+    }
+#endif
+    return true;
+}
+
+enum reader_status reader_next(struct reader* const r, struct reader_block* const block) {
+#ifdef ROME_HAVE_URING
+    if (r->ring != NULL) {
+        const int slot = (int)(r->next % READER_QUEUE_DEPTH);
+        while (r->slots[slot].busy) {
+            if (!reap(r)) {
+                return READER_ERROR;
+            }
+        }
+        if (r->slots[slot].error != 0) {
+            errno = r->slots[slot].error;
+            return READER_ERROR;
+        }
+        if (r->slots[slot].filled == 0) {
+            return READER_END;
+        }
+
+        *block = (struct reader_block) {.data = slot_buffer(r, slot), .len = r->slots[slot].filled};
+        r->position = r->slots[slot].offset + r->slots[slot].filled;
+        r->next++;
+        return READER_BLOCK;
+    }
+#endif
+
+    ssize_t n;
+    do {
+        n = read(r->fd, r->pool, READER_BLOCK_SIZE);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        return READER_ERROR;
+    }
+    if (n == 0) {
+        return READER_END;
+    }
+    *block = (struct reader_block) {.data = r->pool, .len = (size_t)n};
+    return READER_BLOCK;
+}
+
+void reader_release(struct reader* const r) {
+#ifdef ROME_HAVE_URING
+    if (r->ring != NULL) {
+        // The slot of the block handed out last now serves the block READER_QUEUE_DEPTH further ahead
+        issue(r, r->next - 1 + READER_QUEUE_DEPTH);
+    }
+#else
+    (void)r;
+#endif
+}
+
+bool reader_uses_uring(struct reader const* const r) {
+    return r->ring != NULL;
+}
+
+void reader_close(struct reader* const r) {
+    if (r->ring != NULL) {
+#ifdef ROME_HAVE_URING
+        // Drain reads still in flight before their buffers go away
+        for (int slot = 0; slot < READER_QUEUE_DEPTH; ++slot) {
+            while (r->slots[slot].busy && reap(r)) {
+            }
+        }
+        lseek(r->fd, (off_t)r->position, SEEK_SET);
+#endif
+        uring_destroy(r->ring);
+    }
+    free(r->pool);
+    memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Block reader for the CLI's input files.
+//
+// On Linux, regular files are read with io_uring: several large reads are kept in flight, into a fixed pool of
+// buffers that are recycled as soon as the parsing stage is done with them. Blocks are still handed out in file order.
+// Anything else (pipes, terminals, kernels without io_uring or where it is blocked) falls back to plain read(2).
+
+enum { READER_BLOCK_SIZE = 1 << 20, READER_QUEUE_DEPTH = 8 };
+
+// A block of input. It stays valid until it is released.
+struct reader_block {
+    char const* data;
+    size_t len;
+};
+
+enum reader_status {
+    READER_BLOCK, // A block was read
+    READER_END,   // The end of the file was reached
+    READER_ERROR, // A read failed. errno says why.
+};
+
+struct uring;
+
+struct reader {
+    int fd;
+    struct uring* ring; // NULL when reading with read(2)
+    char* pool;         // READER_QUEUE_DEPTH buffers of READER_BLOCK_SIZE bytes (a single one without io_uring)
+    uint64_t start;     // Offset of fd when the reader was opened (io_uring only)
+    uint64_t size;      // Bytes from there to the end of the file (io_uring only)
+    uint64_t position;  // Offset just past the last block handed out (io_uring only)
+    uint64_t next;      // Index of the next block to hand out
+    struct {
+        uint64_t offset; // Offset of the block in the file
+        size_t want;     // Bytes requested
+        size_t filled;   // Bytes read so far
+        bool busy;       // A read is in flight
+        int error;       // errno of a failed read, or zero
+    } slots[READER_QUEUE_DEPTH];
+};
+
+// Starts reading fd from its current offset. fd remains owned by the caller. Returns false if the buffers cannot be
+// allocated. io_uring is tried first unless use_uring is false.
+bool reader_open(struct reader* r, int fd, bool use_uring);
+
+// Waits for the next block, in file order. The previous block must have been released.
+enum reader_status reader_next(struct reader* r, struct reader_block* block);
+
+// Hands the buffer of the last block back to the reader, which immediately reuses it for a read further ahead.
+void reader_release(struct reader* r);
+
+// Whether the reader is using io_uring.
+bool reader_uses_uring(struct reader const* r);
+
+// Releases the buffers (but does not close the file descriptor). As with read(2), the offset of fd is left just past
+// the last block handed out.
+void reader_close(struct reader* r);
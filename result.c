@@ -4,33 +4,90 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 struct result success(const int x) {
     const struct result o = {
         .value = x,
         .error = NULL,
+        .kind = ROME_OK,
+        .offset = 0,
+        .length = 0,
+        .allocator = NULL,
     };
     return o;
 }
 
-struct result errorf(char const* const fmt, ...) {
+struct result errorf(struct rome_allocator const* const allocator, char const* const fmt, ...) {
     va_list args;
+    va_start (args, fmt);
+    const struct result o = verrorf(allocator, fmt, args);
+    va_end (args);
+    return o;
+}
+
+struct result verrorf(struct rome_allocator const* const allocator, char const* const fmt, va_list args) {
+    // Format on the stack, then allocate exactly what the message needs
+    char buff[255];
+    const int len = vsnprintf(buff, sizeof(buff), fmt, args);
+
+    const size_t size = len < 0 ? 1 : (size_t)len < sizeof(buff) ? (size_t)len + 1 : sizeof(buff);
+    struct result o = failure(ROME_ERROR_OTHER, 0, 0);
+    o.error = (char*)allocator->alloc(allocator->state, size);
+    o.allocator = allocator;
+
+    if (o.error == NULL) {
+        // Still report a failure, with a message that needs no freeing
+        o.error = (char*)"out of memory";
+        o.allocator = NULL;
+        return o;
+    }
+
+    memcpy(o.error, buff, size - 1);
+    o.error[size - 1] = '\0';
+    return o;
+}
 
-    const size_t max_size = 255;
+struct result failure(const enum rome_error_kind kind, const int offset, const int length) {
     const struct result o = {
         .value = 0,
-        .error = (char*)calloc(max_size, sizeof(o.value)),
+        .error = (char*)rome_error_string(kind),
+        .kind = kind,
+        .offset = offset,
+        .length = length,
+        .allocator = NULL,
     };
-
-    va_start (args, fmt);
-    vsnprintf(o.error, max_size, fmt, args);
-    va_end (args);
-
     return o;
 }
 
+char const* rome_error_string(const enum rome_error_kind kind) {
+    switch (kind) {
+        case ROME_OK:
+            return "no error";
+        case ROME_ERROR_EMPTY:
+            return "input is empty";
+        case ROME_ERROR_BAD_CHARACTER:
+            return "invalid character";
+        case ROME_ERROR_BAD_PAIR:
+            return "invalid pair";
+        case ROME_ERROR_BAD_REPEAT:
+            return "invalid repetition";
+        case ROME_ERROR_BAD_SEQUENCE:
+            return "invalid sequence";
+        case ROME_ERROR_OVERFLOW:
+            return "value is too large";
+        case ROME_ERROR_NO_NUMERAL:
+            return "value has no roman numeral";
+        case ROME_ERROR_NO_SPACE:
+            return "buffer is too small";
+        case ROME_ERROR_OTHER:
+        default:
+            return "error";
+    }
+}
+
 void free_result(const struct result o) {
-    if (o.error != NULL) {
-        free(o.error);
+    if (o.error != NULL && o.allocator != NULL) {
+        o.allocator->free(o.allocator->state, o.error);
     }
 }
@@ -1,20 +1,53 @@
 #pragma once
 
+#include <stdarg.h>
+
+#include "allocator.h"
+
+// Reason why an input was rejected
+enum rome_error_kind {
+    ROME_OK,                  // Not an error
+    ROME_ERROR_EMPTY,         // There was nothing to parse
+    ROME_ERROR_BAD_CHARACTER, // A character that is not a roman digit (e.g. the Q in XQ)
+    ROME_ERROR_BAD_PAIR,      // A prefix-suffix pair that is not allowed (e.g. VX or IC)
+    ROME_ERROR_BAD_REPEAT,    // A digit repeated too many times (e.g. IIII or VV)
+    ROME_ERROR_BAD_SEQUENCE,  // Two valid tokens in an invalid order (e.g. IVIV)
+    ROME_ERROR_OVERFLOW,      // The value does not fit in the result type
+    ROME_ERROR_NO_NUMERAL,    // The value has no roman representation (zero or negative)
+    ROME_ERROR_NO_SPACE,      // The output buffer is too small
+    ROME_ERROR_OTHER,         // Any other failure (see errorf)
+};
+
 // Option type that contains a value or an error message
 // On success, error will be NULL
-// On failure, error will contain a string
+// On failure, error will contain a string, and kind, offset and length describe what was rejected
 //
 // free_result must be called when error is not NULL
 struct result {
     int value;
     char* error;
+    enum rome_error_kind kind; // ROME_OK on success
+    int offset;                // Byte offset of the rejected input, counted from the start of the input
+    int length;                // Byte length of the rejected input
+    struct rome_allocator const* allocator; // Allocator that owns error. NULL when there is nothing to free.
 };
 
 // convenience function to populate successful results.
 struct result success(int x);
 
 // convenience function to populate failures with sprintf-type arguments.
-struct result errorf(char const* fmt, ...);
+// The message is allocated with the given allocator. The kind is ROME_ERROR_OTHER.
+struct result errorf(struct rome_allocator const* allocator, char const* fmt, ...);
+
+// Same as errorf, with a va_list.
+struct result verrorf(struct rome_allocator const* allocator, char const* fmt, va_list args);
+
+// convenience function to populate failures without formatting any message.
+// The error is a static description of the kind, so nothing is allocated and nothing needs freeing.
+struct result failure(enum rome_error_kind kind, int offset, int length);
+
+// Static, human-readable description of an error kind.
+char const* rome_error_string(enum rome_error_kind kind);
 
 // free the error message. Can be skipped on success.
 void free_result(struct result o);
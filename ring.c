@@ -0,0 +1,284 @@
+#include "ring.h"
+
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rome.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#else
+#include <sched.h>
+#endif
+
+enum {
+    SPINS = 4096,       // Polls before going to sleep, on machines with more than one processor
+    WORKER_BATCH = 64,  // Most numerals answered at once
+    WORKER_NAP_MS = 100 // Longest sleep of the worker, so that it sees shutdowns
+};
+
+static char const magic[8] = "ROMERNG1";
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+// How long to poll before sleeping. On a single processor, whoever is being waited for cannot run while we poll.
+static int spins(void) {
+    static _Atomic int cached = -1;
+    int n = atomic_load_explicit(&cached, memory_order_relaxed);
+    if (n < 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPINS : 0;
+        atomic_store_explicit(&cached, n, memory_order_relaxed);
+    }
+    return n;
+}
+
+// Sleeps while *word holds expected, for at most timeout_ms (forever if zero). Wakes up spuriously at times.
+// The ring is shared between processes, so the futex cannot be a private one.
+static void sleep_on(_Atomic uint32_t* const word, const uint32_t expected, const int timeout_ms) {
+#ifdef __linux__
+    const struct timespec timeout = {.tv_sec = timeout_ms / 1000, .tv_nsec = (long)(timeout_ms % 1000) * 1000000};
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout_ms ? &timeout : NULL, NULL, 0);
+#else
+    (void)word, (void)expected, (void)timeout_ms;
+    sched_yield();
+#endif
+}
+
+static void wake(_Atomic uint32_t* const word) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Producer side: waits until seq reaches target
+static void await(struct rome_ring* const ring, _Atomic uint32_t* const seq, const uint32_t target) {
+    for (int i = spins(); i > 0; --i) {
+        if (atomic_load_explicit(seq, memory_order_acquire) == target) {
+            return;
+        }
+        cpu_relax();
+    }
+
+    // Announcing the sleeper before checking again pairs with the store-then-check in hand_over: either the waker
+    // sees the sleeper, or the sleeper sees the new value
+    atomic_fetch_add(&ring->producers_waiting, 1);
+    uint32_t current;
+    while ((current = atomic_load(seq)) != target) {
+        sleep_on(seq, current, 0);
+    }
+    atomic_fetch_sub(&ring->producers_waiting, 1);
+}
+
+// Sets a slot's sequence number, and wakes whoever may be sleeping on it
+static void hand_over(_Atomic uint32_t* const seq, const uint32_t value, _Atomic uint32_t* const sleepers) {
+    atomic_store(seq, value);
+    if (atomic_load(sleepers) != 0) {
+        wake(seq);
+    }
+}
+
+size_t rome_ring_size(const uint32_t capacity) {
+    return sizeof(struct rome_ring) + (size_t)capacity * sizeof(struct rome_ring_slot);
+}
+
+struct rome_ring* rome_ring_init(void* const memory, const size_t size, const uint32_t capacity) {
+    if (capacity < 4 || (capacity & (capacity - 1)) != 0 || size < rome_ring_size(capacity)) {
+        return NULL;
+    }
+
+    struct rome_ring* const ring = memory;
+    ring->capacity = capacity;
+    atomic_init(&ring->shutdown, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->producers_waiting, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->worker_waiting, 0);
+    for (uint32_t i = 0; i < capacity; ++i) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+
+    // The magic goes last, so that a process attaching early does not see a half-built ring
+    atomic_thread_fence(memory_order_release);
+    memcpy(ring->magic, magic, sizeof(magic));
+    return ring;
+}
+
+struct rome_ring* rome_ring_attach(void* const memory, const size_t size) {
+    struct rome_ring* const ring = memory;
+    if (size < sizeof(struct rome_ring) || memcmp(ring->magic, magic, sizeof(magic)) != 0) {
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (size < rome_ring_size(ring->capacity)) {
+        return NULL;
+    }
+    return ring;
+}
+
+// Claims the next ticket if its slot is free. Returns false if the ring is full, with the ticket whose slot is busy and
+// the sequence number seen there.
+static bool claim(struct rome_ring* const ring, uint32_t* const ticket, uint32_t* const seen) {
+    uint32_t t = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (true) {
+        struct rome_ring_slot* const slot = &ring->slots[t & (ring->capacity - 1)];
+        const uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == t) {
+            // Free. On failure, t is reloaded with the ticket another producer left for us.
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &t, t + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                *ticket = t;
+                return true;
+            }
+        } else if ((int32_t)(seq - t) < 0) {
+            // Still in use since the previous lap
+            *ticket = t;
+            *seen = seq;
+            return false;
+        } else {
+            // Claimed by another producer since head was read
+            t = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+}
+
+// Copies the numeral into the slot of a claimed ticket, and hands it to the worker
+static void publish(struct rome_ring* const ring, const uint32_t t, char const* const numeral, const size_t len) {
+    struct rome_ring_slot* const slot = &ring->slots[t & (ring->capacity - 1)];
+    memcpy(slot->numeral, numeral, len);
+    slot->len = (uint32_t)len;
+    hand_over(&slot->seq, t + 1, &ring->worker_waiting);
+}
+
+enum rome_ring_status rome_ring_try_send(struct rome_ring* const ring, char const* const numeral, const size_t len,
+                                         uint32_t* const ticket) {
+    if (len > ROME_RING_NUMERAL_MAX) {
+        return ROME_RING_TOO_LONG;
+    }
+    uint32_t seen;
+    if (!claim(ring, ticket, &seen)) {
+        return ROME_RING_FULL;
+    }
+    publish(ring, *ticket, numeral, len);
+    return ROME_RING_SENT;
+}
+
+enum rome_ring_status rome_ring_send(struct rome_ring* const ring, char const* const numeral, const size_t len,
+                                     uint32_t* const ticket) {
+    if (len > ROME_RING_NUMERAL_MAX) {
+        return ROME_RING_TOO_LONG;
+    }
+
+    uint32_t seen;
+    for (int i = spins(); !claim(ring, ticket, &seen); --i) {
+        if (i > 0) {
+            cpu_relax();
+            continue;
+        }
+
+        // Sleeps until the slot at head moves on. Announcing the sleeper first pairs with hand_over (see await).
+        _Atomic uint32_t* const seq = &ring->slots[*ticket & (ring->capacity - 1)].seq;
+        atomic_fetch_add(&ring->producers_waiting, 1);
+        if (atomic_load(seq) == seen) {
+            sleep_on(seq, seen, 0);
+        }
+        atomic_fetch_sub(&ring->producers_waiting, 1);
+    }
+
+    publish(ring, *ticket, numeral, len);
+    return ROME_RING_SENT;
+}
+
+void rome_ring_receive(struct rome_ring* const ring, const uint32_t ticket, int32_t* const value,
+                       enum rome_error_kind* const kind) {
+    struct rome_ring_slot* const slot = &ring->slots[ticket & (ring->capacity - 1)];
+    await(ring, &slot->seq, ticket + 2);
+
+    *value = slot->value;
+    *kind = (enum rome_error_kind)slot->kind;
+    hand_over(&slot->seq, ticket + ring->capacity, &ring->producers_waiting);
+}
+
+// Worker side: waits until the slot of ticket t holds a numeral. Returns false if the ring was shut down first.
+static bool await_request(struct rome_ring* const ring, const uint32_t t) {
+    _Atomic uint32_t* const seq = &ring->slots[t & (ring->capacity - 1)].seq;
+    for (int i = spins(); i > 0; --i) {
+        if (atomic_load_explicit(seq, memory_order_acquire) == t + 1) {
+            return true;
+        }
+        cpu_relax();
+    }
+
+    atomic_store(&ring->worker_waiting, 1);
+    uint32_t current;
+    while ((current = atomic_load(seq)) != t + 1) {
+        if (atomic_load_explicit(&ring->shutdown, memory_order_relaxed)) {
+            atomic_store(&ring->worker_waiting, 0);
+            return false;
+        }
+        sleep_on(seq, current, WORKER_NAP_MS);
+    }
+    atomic_store(&ring->worker_waiting, 0);
+    return true;
+}
+
+size_t rome_ring_work(struct rome_ctx* const ctx, struct rome_ring* const ring, const bool block) {
+    const uint32_t mask = ring->capacity - 1;
+    const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (atomic_load_explicit(&ring->slots[tail & mask].seq, memory_order_acquire) != tail + 1) {
+        if (!block || !await_request(ring, tail)) {
+            return 0;
+        }
+    }
+
+    // Takes the whole run of published numerals, up to a batch. Lengths come from shared memory, so they are checked
+    // here too: a producer that skips the check in rome_ring_send gets an error, and never makes the worker read past
+    // its slot.
+    struct rome_span numerals[WORKER_BATCH];
+    size_t parsed[WORKER_BATCH]; // Slot of each numeral, relative to tail
+    size_t n = 0, m = 0;
+    do {
+        struct rome_ring_slot* const slot = &ring->slots[(tail + n) & mask];
+        const uint32_t len = slot->len;
+        if (len <= ROME_RING_NUMERAL_MAX) {
+            numerals[m] = (struct rome_span) {.ptr = slot->numeral, .len = len};
+            parsed[m++] = n;
+        } else {
+            slot->value = 0;
+            slot->kind = ROME_ERROR_OTHER;
+        }
+        ++n;
+    } while (n < WORKER_BATCH && n < ring->capacity &&
+             atomic_load_explicit(&ring->slots[(tail + n) & mask].seq, memory_order_acquire) == tail + n + 1);
+
+    int32_t values[WORKER_BATCH];
+    enum rome_error_kind kinds[WORKER_BATCH];
+    rome_parse_batch(ctx, numerals, m, values, kinds);
+
+    for (size_t i = 0; i < m; ++i) {
+        struct rome_ring_slot* const slot = &ring->slots[(tail + parsed[i]) & mask];
+        slot->value = values[i];
+        slot->kind = kinds[i];
+    }
+    for (size_t i = 0; i < n; ++i) {
+        hand_over(&ring->slots[(tail + i) & mask].seq, tail + (uint32_t)i + 2, &ring->producers_waiting);
+    }
+
+    atomic_store_explicit(&ring->tail, tail + (uint32_t)n, memory_order_relaxed);
+    return n;
+}
+
+void rome_ring_shutdown(struct rome_ring* const ring) {
+    atomic_store(&ring->shutdown, 1);
+}
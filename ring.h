@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "result.h"
+
+// Shared-memory request ring, for producers on the same machine that cannot afford a socket round trip.
+//
+// The ring lives in memory mapped by every process involved (e.g. with shm_open). Producers, one or many, claim a slot,
+// copy a numeral into it and publish it. One worker answers published slots in order, in batches, and writes the
+// results back into the same slots. The producer then reads its result and frees the slot for the next lap.
+//
+// There are no locks. Producers take tickets in order, with a compare-and-swap on head, and each slot has a sequence
+// number that says whose turn it is; for the slot of ticket t:
+//   t                 free, for the producer holding ticket t
+//   t + 1             a numeral is waiting for the worker
+//   t + 2             the result is ready for the producer
+//   t + capacity      free again, for ticket t + capacity
+// Waiting spins for a while and then sleeps on the sequence number with a futex, which is only woken when someone
+// sleeps. Elsewhere than on Linux, sleeping yields the processor instead.
+
+enum { ROME_RING_NUMERAL_MAX = 48 }; // Longer numerals cannot be sent
+
+struct rome_ring_slot {
+    _Alignas(64) _Atomic uint32_t seq; // See above
+    uint32_t len;                      // Length of numeral
+    int32_t value;                     // Only meaningful if kind is ROME_OK
+    int32_t kind;                      // enum rome_error_kind
+    char numeral[ROME_RING_NUMERAL_MAX];
+};
+
+struct rome_ring {
+    char magic[8];     // "ROMERNG1"
+    uint32_t capacity; // Number of slots, a power of two
+    _Atomic uint32_t shutdown;
+    _Alignas(64) _Atomic uint32_t head;    // Next ticket for producers
+    _Atomic uint32_t producers_waiting;    // Producers sleeping on a slot
+    _Alignas(64) _Atomic uint32_t tail;    // Next ticket for the worker
+    _Atomic uint32_t worker_waiting;       // Whether the worker is sleeping
+    struct rome_ring_slot slots[];
+};
+
+// Bytes of shared memory needed for a ring of capacity slots.
+size_t rome_ring_size(uint32_t capacity);
+
+// Sets up a ring in size bytes of shared memory. capacity must be a power of two, at least 4: with fewer slots, the
+// states of a slot above would overlap.
+// Returns NULL if it is not, or if the memory is too small.
+struct rome_ring* rome_ring_init(void* memory, size_t size, uint32_t capacity);
+
+// Checks that size bytes of shared memory hold a ring set up by another process. Returns NULL if they do not.
+struct rome_ring* rome_ring_attach(void* memory, size_t size);
+
+enum rome_ring_status {
+    ROME_RING_SENT,     // The numeral was published. Its result comes with the ticket.
+    ROME_RING_FULL,     // Every slot is taken. Nothing was sent.
+    ROME_RING_TOO_LONG, // The numeral is longer than ROME_RING_NUMERAL_MAX. Nothing was sent.
+};
+
+// Producer: copies a numeral into the next slot and publishes it, unless the ring is full.
+// A slot is only claimed once it is free, so a producer never waits on a claim. A producer with several numerals in
+// flight should receive one of its results when the ring is full: waiting could mean waiting for itself.
+enum rome_ring_status rome_ring_try_send(struct rome_ring* ring, char const* numeral, size_t len, uint32_t* ticket);
+
+// Producer: same as rome_ring_try_send, but waits while the ring is full. Only for producers with no results pending.
+enum rome_ring_status rome_ring_send(struct rome_ring* ring, char const* numeral, size_t len, uint32_t* ticket);
+
+// Producer: waits for the result of a ticket, and frees its slot.
+void rome_ring_receive(struct rome_ring* ring, uint32_t ticket, int32_t* value, enum rome_error_kind* kind);
+
+// Worker: answers the numerals waiting at the tail with rome_parse_batch. If there are none and block is set, waits
+// until there are, or until the ring is shut down. Returns the number of numerals answered. Slots whose length exceeds
+// ROME_RING_NUMERAL_MAX (which rome_ring_send never publishes) are answered with ROME_ERROR_OTHER without being read.
+size_t rome_ring_work(struct rome_ctx* ctx, struct rome_ring* ring, bool block);
+
+// Asks a worker blocked in rome_ring_work to return. It notices within a tenth of a second.
+void rome_ring_shutdown(struct rome_ring* ring);
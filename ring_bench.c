@@ -0,0 +1,239 @@
+// Benchmark for the shared-memory ring (see ring.h).
+// Runs a worker in a child process, unless --ring names one started with "rome serve --ring", and producer threads in
+// this one. Every result is checked. Reports throughput and round-trip latency.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ring.h"
+#include "rome.h"
+
+static char numerals[4000][16]; // Canonical numeral of every value the producers send
+static size_t lengths[4000];
+
+struct producer {
+    pthread_t thread;
+    struct rome_ring* ring;
+    size_t requests;
+    size_t pipeline;
+    double* latencies; // One per request
+    bool failed;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(void const* const a, void const* const b) {
+    const double x = *(double const*)a, y = *(double const*)b;
+    return (x > y) - (x < y);
+}
+
+static void* produce(void* const arg) {
+    struct producer* const p = arg;
+    uint32_t tickets[256];
+    double started[256];
+
+    // Keeps up to pipeline numerals in flight, and receives the oldest whenever it cannot send
+    size_t sent = 0, received = 0;
+    while (received < p->requests) {
+        if (sent < p->requests && sent - received < p->pipeline) {
+            const size_t value = sent % 3999 + 1;
+            started[sent % p->pipeline] = now();
+            // With nothing in flight, waiting for a slot is safe
+            const enum rome_ring_status status = sent == received
+                ? rome_ring_send(p->ring, numerals[value], lengths[value], &tickets[sent % p->pipeline])
+                : rome_ring_try_send(p->ring, numerals[value], lengths[value], &tickets[sent % p->pipeline]);
+            if (status == ROME_RING_SENT) {
+                ++sent;
+                continue;
+            }
+        }
+
+        int32_t value;
+        enum rome_error_kind kind;
+        rome_ring_receive(p->ring, tickets[received % p->pipeline], &value, &kind);
+        p->latencies[received] = now() - started[received % p->pipeline];
+        if (kind != ROME_OK || value != (int32_t)(received % 3999 + 1)) {
+            p->failed = true;
+        }
+        ++received;
+    }
+    return NULL;
+}
+
+static bool parse_count(char const* const arg, size_t* const out) {
+    char* end;
+    const unsigned long n = strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || n == 0) {
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+static void usage(FILE* const f, char const* const argv0) {
+    fprintf(f,
+        "usage: %s [options]\n"
+        "Sends numerals through a shared-memory ring and reports how fast they are answered.\n"
+        "\n"
+        "  --ring NAME         Use the ring of \"rome serve --ring NAME\" instead of starting a worker\n"
+        "  --slots N           Slots of the ring started here, a power of two from 4 (default: 1024)\n"
+        "  --producers N       Producer threads (default: 1)\n"
+        "  --requests N        Numerals sent by each producer (default: 1000000)\n"
+        "  --pipeline N        Numerals in flight per producer, at most 256 (default: 1)\n"
+        "  --help              Show this message\n",
+        argv0);
+}
+
+int main(const int argc, char* const* const argv) {
+    enum { OPT_RING = 256, OPT_SLOTS, OPT_PRODUCERS, OPT_REQUESTS, OPT_PIPELINE, OPT_HELP };
+    static const struct option options[] = {
+        {"ring", required_argument, NULL, OPT_RING},
+        {"slots", required_argument, NULL, OPT_SLOTS},
+        {"producers", required_argument, NULL, OPT_PRODUCERS},
+        {"requests", required_argument, NULL, OPT_REQUESTS},
+        {"pipeline", required_argument, NULL, OPT_PIPELINE},
+        {"help", no_argument, NULL, OPT_HELP},
+        {NULL, 0, NULL, 0},
+    };
+
+    char const* name = NULL;
+    size_t slots = 1024, producers = 1, requests = 1000000, pipeline = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        size_t* count = NULL;
+        switch (opt) {
+            case OPT_RING:
+                name = optarg;
+                break;
+            case OPT_SLOTS:
+                count = &slots;
+                break;
+            case OPT_PRODUCERS:
+                count = &producers;
+                break;
+            case OPT_REQUESTS:
+                count = &requests;
+                break;
+            case OPT_PIPELINE:
+                count = &pipeline;
+                break;
+            case OPT_HELP:
+                usage(stdout, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr, argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (count != NULL && !parse_count(optarg, count)) {
+            fprintf(stderr, "%s: expected a positive number: %s\n", argv[0], optarg);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc || pipeline > 256 || slots > UINT32_MAX / 2) {
+        usage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (int value = 1; value < 4000; ++value) {
+        lengths[value] = (size_t)format_roman(value, numerals[value], sizeof(numerals[value]));
+    }
+
+    // Either attaches to a running server, or sets up a ring and forks a worker for it
+    struct rome_ring* ring;
+    size_t size;
+    pid_t worker = 0;
+    if (name != NULL) {
+        const int fd = shm_open(name, O_RDWR, 0);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            perror(name);
+            return EXIT_FAILURE;
+        }
+        size = (size_t)st.st_size;
+        void* const memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        ring = memory == MAP_FAILED ? NULL : rome_ring_attach(memory, size);
+    } else {
+        size = rome_ring_size((uint32_t)slots);
+        void* const memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        ring = memory == MAP_FAILED ? NULL : rome_ring_init(memory, size, (uint32_t)slots);
+    }
+    if (ring == NULL) {
+        fprintf(stderr, "%s: cannot set up the ring\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (name == NULL) {
+        worker = fork();
+        if (worker < 0) {
+            perror("fork");
+            return EXIT_FAILURE;
+        }
+        if (worker == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL); // Do not outlive an interrupted benchmark
+            struct rome_ctx ctx;
+            rome_ctx_init(&ctx);
+            while (rome_ring_work(&ctx, ring, true) > 0) {
+            }
+            _exit(EXIT_SUCCESS);
+        }
+    }
+
+    struct producer* const threads = calloc(producers, sizeof(struct producer));
+    double* const latencies = malloc(producers * requests * sizeof(double));
+    if (threads == NULL || latencies == NULL) {
+        perror(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const double start = now();
+    for (size_t i = 0; i < producers; ++i) {
+        threads[i] = (struct producer) {
+            .ring = ring, .requests = requests, .pipeline = pipeline, .latencies = latencies + i * requests};
+        pthread_create(&threads[i].thread, NULL, produce, &threads[i]);
+    }
+    bool failed = false;
+    for (size_t i = 0; i < producers; ++i) {
+        pthread_join(threads[i].thread, NULL);
+        failed |= threads[i].failed;
+    }
+    const double elapsed = now() - start;
+
+    if (worker > 0) {
+        rome_ring_shutdown(ring);
+        waitpid(worker, NULL, 0);
+    }
+    munmap(ring, size);
+
+    if (failed) {
+        fprintf(stderr, "%s: wrong results\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t total = producers * requests;
+    qsort(latencies, total, sizeof(double), compare_doubles);
+    printf("%zu producers, %zu numerals each, %zu in flight each, in %.3f s\n", producers, requests, pipeline, elapsed);
+    printf("%.0f numerals/s\n", (double)total / elapsed);
+    printf("round trip: p50 %.2f us, p99 %.2f us, max %.1f us\n", latencies[total / 2] * 1e6,
+        latencies[total * 99 / 100] * 1e6, latencies[total - 1] * 1e6);
+
+    free(threads);
+    free(latencies);
+    return EXIT_SUCCESS;
+}
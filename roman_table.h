@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Table of the canonical numerals 1..3999, generated at build time by gen_table.
+// The numeral for v is [roman_table_text + roman_table_offsets[v], roman_table_text + roman_table_offsets[v+1]).
+#define ROMAN_TABLE_MAX 3999
+
+extern const uint32_t roman_table_offsets[ROMAN_TABLE_MAX + 2];
+extern const char roman_table_text[];
+
+// The same table as a flat file that several processes can map and share. All integers are little-endian:
+//     char     magic[8]                        ROMAN_TABLE_MAGIC
+//     uint32_t max                             ROMAN_TABLE_MAX
+//     uint32_t text_size                       Total length of the numerals
+//     uint32_t offsets[ROMAN_TABLE_MAX + 2]    Same as roman_table_offsets
+//     char     text[text_size]                 Same as roman_table_text, without terminator
+#define ROMAN_TABLE_MAGIC "ROMETBL1"
+
+// A mapped table file
+struct roman_table {
+    uint32_t const* offsets;
+    char const* text;
+    void* map;       // Base of the mapping
+    size_t map_size; // Size of the mapping
+};
+
+// Maps the table file at path, read-only and shared. Returns false if it cannot be mapped or is not a valid table.
+// Only supported on little-endian hosts, where the offsets can be used in place.
+bool roman_table_map(struct roman_table* table, char const* path);
+
+// Unmaps a table mapped by roman_table_map.
+void roman_table_unmap(struct roman_table* table);
@@ -1,8 +1,14 @@
+#include <stdarg.h>
 #include <stdbool.h>
-#include <assert.h>
 
+#include "dfa.h"
+#include "generated.h"
+#include "instrument.h"
+#include "lenient.h"
+#include "probes.h"
 #include "rome.h"
 #include "result.h"
+#include "token.h"
 
 /*
  * In order to parse (or reject) inputs, the following three steps are performed:
@@ -14,306 +20,278 @@
  *  3. The values of the tokens are added up.
  */
 
-enum token_type {
-    PAIR,     // Prefix-suffix pair  (IV, XC, etc.)
-    REPEAT    // Repeated value (I, II, CCC, etc.). Single-numerals (I, L) are considered trivial repeats.
-};
-
-struct token {
-    enum token_type type; // Type of token
-    union {
-        // When parsing a pair
-        struct {
-            int prefix;
-            int suffix;
-        };
-        // When parsing repeated digits
-        struct {
-            int digit;
-            int count;
-        };
-    };
-};
-
-// Converts a token into its numeral value (e.g. XC returns 90)
-int token_value(struct token t);
-
-// Converts one-character digits to their character.
-// This means 1, 5, 10, etc. are valid inputs, but 2, 9, 600 are not.
-char digit_to_roman(int d);
-
-// Writes a token to a buffer of length 'len'. It returns true if the buffer was large enough to fit the string.
-// 4 bytes is enough to fit any token.
-bool sprint_token(char* buff, int len, struct token t);
-
-// Checks that a prefix-suffix pair is valid: IV is good but LC is not.
-bool valid_pair(int prefix, int suffix);
-
-// Checks that a repetition is valid. III is good but LL is not.
-bool valid_repeats(int main, int count);
-
-// Checks that two tokens can go one after another. (C)(I) is good but (IX)(I) is not.
-bool valid_sequence(struct token first, struct token second);
-
-// Parses the numerical value of a character into *out. Returns false if the character is not a roman numeral.
-bool parse_roman_character(char c, int *out);
-
-// Reads from str and writes the resulting token to t.
-// Returns a result containing the count of characters consumed, or an error message otherwise.
-struct result consume_next_token(char const* str, struct token* t);
+// Builds a failure of the given kind, spanning length bytes starting at offset. The sprintf-type message is only
+// formatted (and allocated) if the context asks for formatted errors.
+static struct result fail(struct rome_ctx* ctx, enum rome_error_kind kind, int offset, int length, char const* fmt, ...);
+
+// Turns the reason why scan_numeral rejected [str, end) into a result with a human-readable message.
+static struct result describe_failure(struct rome_ctx* ctx, char const* str, char const* end, struct scan_error err);
+
+// Traces a rejection that scan_numeral describes in err. Returns false. Rejections are counted by the entry points, since
+// scan_numeral also reads the operands of arith.c.
+static bool reject(struct scan_error const* err);
+
+// Parses the numeral in [str, end) with the context's engine, without touching the stats.
+static struct result parse_span(struct rome_ctx* ctx, char const* str, char const* end);
+
+// Parses [str, end) with the tables of a dialect other than the strict one, whatever the engine.
+static struct result parse_dialect(struct rome_ctx* ctx, char const* str, char const* end);
+
+// Returns the end of the line starting at str: its newline or its null terminator.
+static char const* line_end(char const* str);
 
 struct result parse_roman_number(const char* str) {
-    if (*str == '\0') {
-        return errorf("input is empty");
+    const uint64_t start = latency_start();
+    struct rome_ctx ctx;
+    rome_ctx_init(&ctx);
+    char const* const end = line_end(str);
+    ROME_PROBE2(parse__start, str, (size_t)(end - str));
+    const struct result res = parse_span(&ctx, str, end);
+    ROME_PROBE3(parse__end, (size_t)(end - str), res.value, (int)res.kind);
+    if (res.error != NULL) {
+        count_rejection(res.kind);
     }
+    latency_record(start, (size_t)(end - str), res.error != NULL);
+    return res;
+}
 
-    struct token prev;
-    int tally = 0;
+struct result rome_parse(struct rome_ctx* const ctx, const char* const str) {
+    return rome_parse_n(ctx, str, (size_t)(line_end(str) - str));
+}
 
-    // Get first token
-    {
-        const struct result res = consume_next_token(str, &prev);
-        if (res.error) {
-            return res;
-        }
-        str += res.value;
-        tally += token_value(prev);
+struct result rome_parse_n(struct rome_ctx* const ctx, char const* const ptr, const size_t len) {
+    const uint64_t start = latency_start();
+    ROME_PROBE2(parse__start, ptr, len);
+    const struct result res = parse_span(ctx, ptr, ptr + len);
+    ROME_PROBE3(parse__end, len, res.value, (int)res.kind);
+    ctx->stats.parsed++;
+    ctx->stats.rejected += res.error != NULL;
+    if (res.error != NULL) {
+        count_rejection(res.kind);
     }
+    latency_record(start, len, res.error != NULL);
+    return res;
+}
 
-    // Get remaining tokens
+void rome_parse_batch(struct rome_ctx* const ctx, struct rome_span const* const numerals, const size_t n,
+                      int32_t* const values, enum rome_error_kind* const kinds) {
+    const bool format_errors = ctx->format_errors;
+    ctx->format_errors = false;
+    for (size_t i = 0; i < n; ++i) {
+        const struct result res = rome_parse_n(ctx, numerals[i].ptr, numerals[i].len);
+        values[i] = res.value;
+        kinds[i] = res.kind;
+    }
+    ctx->format_errors = format_errors;
+}
+
+static char const* line_end(char const* str) {
     while (*str != '\n' && *str != '\0') {
+        ++str;
+    }
+    return str;
+}
+
+static struct result parse_span(struct rome_ctx* const ctx, const char* const str, char const* const end) {
+    if (ctx->dialect != ROME_DIALECT_STRICT) {
+        return parse_dialect(ctx, str, end);
+    }
+
+    int value;
+    if (ctx->engine == ROME_ENGINE_DFA && dfa_parse(ctx->dfa, str, (size_t)(end - str), &value)) {
+        return success(value);
+    }
+    if (ctx->engine == ROME_ENGINE_GENERATED && generated_parse(str, (size_t)(end - str), &value)) {
+        return success(value);
+    }
+    if (ctx->engine == ROME_ENGINE_LENIENT) {
+        struct scan_error err;
+        if (!lenient_numeral(str, end, &value, &err)) {
+            return describe_failure(ctx, str, end, err);
+        }
+        return success(value);
+    }
+
+    // The tokenizer is also the slow path of the DFA and generated engines: it works out why they rejected the input
+    struct scan_error err;
+    if (!scan_numeral(str, end, &value, &err)) {
+        return describe_failure(ctx, str, end, err);
+    }
+    if (ctx->engine == ROME_ENGINE_GENERATED && !generated_matches_tokenizer) {
+        // rome.grammar allows fewer numerals than the tokenizer
+        err = (struct scan_error) {.kind = ROME_ERROR_OTHER, .offset = 0, .length = (int)(end - str)};
+        reject(&err);
+        return fail(ctx, err.kind, err.offset, err.length, "not a numeral of rome.grammar");
+    }
+    return success(value);
+}
+
+static bool reject(struct scan_error const* const err) {
+    ROME_PROBE3(reject, (int)err->kind, err->offset, err->length);
+    return false;
+}
+
+static struct result parse_dialect(struct rome_ctx* const ctx, char const* const str, char const* const end) {
+    int value;
+    if (dfa_parse(ctx->dfa, str, (size_t)(end - str), &value)) {
+        return success(value);
+    }
+
+    struct scan_error err;
+    dfa_explain(ctx->dfa, str, (size_t)(end - str), &err);
+    reject(&err);
+    if (err.kind == ROME_ERROR_BAD_SEQUENCE) {
+        // describe_failure would rescan with the strict rules, which may not apply
+        return fail(ctx, err.kind, err.offset, err.length, "%c is not allowed here in this dialect", str[err.offset]);
+    }
+    return describe_failure(ctx, str, end, err);
+}
+
+bool scan_numeral(char const* str, char const* const end, int* const value, struct scan_error* const err) {
+    if (str == end) {
+        *err = (struct scan_error) {.kind = ROME_ERROR_EMPTY, .offset = 0, .length = 0};
+        return reject(err);
+    }
+
+    char const* const begin = str;
+    struct token prev = {0}; // Only read from the second token on, but the compiler cannot always tell
+    int tally = 0;
+
+    while (str != end) {
         struct token next;
-        const struct result res = consume_next_token(str, &next);
-        if (res.error) {
-            return res;
+        const int consumed = scan_token(str, end, &next, err);
+        if (consumed == 0) {
+            err->offset += (int)(str - begin);
+            return reject(err);
         }
-        assert(res.value > 0);
 
-        if (!valid_sequence(prev, next)) {
-            char buff1[32], buff2[32];
-            sprint_token(buff1, 32, prev);
-            sprint_token(buff2, 32, next);
-            return errorf(" %s cannot be followed by %s", buff1, buff2);
+        if (str != begin && !valid_sequence(prev, next)) {
+            *err = (struct scan_error) {.kind = ROME_ERROR_BAD_SEQUENCE, .offset = (int)(str - begin), .length = consumed};
+            return reject(err);
+        }
+
+        if (!add_token_value(&tally, next)) {
+            *err = (struct scan_error) {.kind = ROME_ERROR_OVERFLOW, .offset = 0, .length = (int)(end - begin)};
+            return reject(err);
         }
+        ROME_PROBE3(token, (int)(str - begin), consumed, token_value(next));
 
-        str += res.value;
-        tally += token_value(next);
+        str += consumed;
         prev = next;
     }
 
-    return success(tally);
+    *value = tally;
+    return true;
+}
+
+static struct result describe_failure(struct rome_ctx* const ctx, char const* const str, char const* const end,
+                                      const struct scan_error err) {
+    char const* const at = str + err.offset;
+    switch (err.kind) {
+        case ROME_ERROR_EMPTY:
+            return fail(ctx, err.kind, err.offset, err.length, "input is empty");
+        case ROME_ERROR_BAD_CHARACTER:
+            return fail(ctx, err.kind, err.offset, err.length, "invalid character: %c", *at);
+        case ROME_ERROR_BAD_PAIR:
+            return fail(ctx, err.kind, err.offset, err.length, "invalid pair: %c%c", at[0], at[1]);
+        case ROME_ERROR_BAD_REPEAT:
+            return fail(ctx, err.kind, err.offset, err.length,
+                "character %c cannot appear %d times in a row", *at, err.length);
+        case ROME_ERROR_BAD_SEQUENCE: {
+            // Only the failing pair of tokens is needed, so they are scanned again instead of kept around by the hot loop
+            struct token prev, next;
+            struct scan_error unused;
+            char const* it = str;
+            int consumed = scan_token(it, end, &prev, &unused);
+            while (it + consumed != at) {
+                it += consumed;
+                consumed = scan_token(it, end, &prev, &unused);
+            }
+            scan_token(at, end, &next, &unused);
+
+            char buff1[32], buff2[32];
+            sprint_token(buff1, 32, prev);
+            sprint_token(buff2, 32, next);
+            return fail(ctx, err.kind, err.offset, err.length, " %s cannot be followed by %s", buff1, buff2);
+        }
+        case ROME_ERROR_OVERFLOW:
+            return fail(ctx, err.kind, err.offset, err.length, "value is too large");
+        default:
+            return fail(ctx, err.kind, err.offset, err.length, "%s", rome_error_string(err.kind));
+    }
 }
 
-struct result consume_next_token(char const* str, struct token* t) {
+int scan_token(char const* str, char const* const end, struct token* t, struct scan_error* const err) {
     // First character
-    if (*str == '\0' || *str == '\n') {
-        return errorf("EOF");
+    if (str == end) {
+        *err = (struct scan_error) {.kind = ROME_ERROR_EMPTY, .offset = 0, .length = 0};
+        return 0;
     }
 
     int first;
     if (!parse_roman_character(str[0], &first)) {
-        return errorf("invalid character: %c", str[0]);
+        *err = (struct scan_error) {.kind = ROME_ERROR_BAD_CHARACTER, .offset = 0, .length = 1};
+        return 0;
     }
 
     // Second character -> decides between pair and repeat
-    if (str[1] == '\0' || str[1] == '\n') {
+    if (str + 1 == end) {
         *t = (struct token) {.type = REPEAT, .digit = first, .count = 1};
-        return success(1);
+        return 1;
     }
 
     int second;
     if (!parse_roman_character(str[1], &second)) {
-        return errorf("invalid character: %c", str[0]);
+        *err = (struct scan_error) {.kind = ROME_ERROR_BAD_CHARACTER, .offset = 1, .length = 1};
+        return 0;
     }
 
     if (first < second) {
         // It's a pair!
         // Something like XL or IV
         if (!valid_pair(first, second)) {
-            return errorf("invalid pair: %c%c", str[0], str[1]);
+            *err = (struct scan_error) {.kind = ROME_ERROR_BAD_PAIR, .offset = 0, .length = 2};
+            return 0;
         }
         *t = (struct token) {.type = PAIR, .prefix = first, .suffix = second};
-        return success(2); // 2 characters consumed
+        return 2; // 2 characters consumed
     }
 
     if (first > second) {
         // It was a lonely character (trivial repeat)
         *t = (struct token) {.type = REPEAT, .digit = first, .count = 1};
-        return success(1); // Only the first character was consumed, next invocation can deal with the second one
+        return 1; // Only the first character was consumed, next invocation can deal with the second one
     }
 
     // Repetition! Keep reading until character changes
     const char* it;
-    for (it = str+2; *str == *it; ++it) {
+    for (it = str+2; it != end && *str == *it; ++it) {
         // Empty loop
     }
 
     const int count = (int)(it - str);
     if (!valid_repeats(first, count)) {
-        return errorf("character %c cannot appear %d times in a row", *str, count);
+        *err = (struct scan_error) {.kind = ROME_ERROR_BAD_REPEAT, .offset = 0, .length = count};
+        return 0;
     }
 
     *t = (struct token) {.type = REPEAT, .digit = first, .count = count};
-    return success(t->count);
-}
-
-int token_value(const struct token t) {
-    switch (t.type) {
-        case REPEAT:
-            return t.digit * t.count;
-        case PAIR:
-            return t.suffix - t.prefix;
-        default:
-            assert(false);
-            __builtin_unreachable();
-    }
-}
-
-bool sprint_token(char *const buff, const int len, const struct token t) {
-    switch (t.type) {
-        case REPEAT: {
-            if (len < t.count+1) {
-                return false;
-            }
-            const char d = digit_to_roman(t.digit);
-            for (int i = 0; i<t.count; ++i) {
-                buff[i] = d;
-            }
-            buff[t.count] = '\0';
-            return true;
-        }
-        case PAIR: {
-            if (len < 3) {
-                return false;
-            }
-            buff[0] = digit_to_roman(t.prefix);
-            buff[1] = digit_to_roman(t.suffix);
-            buff[2] = '\0';
-            return true;
-        }
-        default:
-            assert(false);
-            __builtin_unreachable();
-    }
+    return t->count;
 }
 
-bool valid_sequence(const struct token first, const struct token second) {
-    /*
-    I have determined that the following two rules are true:
-        1. The first character of consecutive tokens must decrease (XXX can be followed by IX because X<I)
-        2. If the first token is V, L or D; the following must also decrease in last character (V cannot be followed by IV because V=V)
-    These rules exclude things like XX followed by X, because this would have been tokenized as XXX.
-    They also exclude invalid tokens like VC, IM, LL, etc.
-
-    See the rules expanded (A+ means any of A,AA,AAA):
-        I+ is terminal
-        IV is terminal
-        IX is terminal
-        V  can be followed by I+ (rule 2 disallows IV,IX)
-        X+ can be followed by I+,IV,V,IX
-        XL can be followed by I+,IV,V,IX
-        XC can be followed by I+,IV,V,IX
-        L  can be followed by I+,IV,V,IX,X+ (rule 2 disallows XL,XC)
-        C+ can be followed by I+,IV,V,IX,X+,XL,L,XC
-        CD can be followed by I+,IV,V,IX,X+,XL,L,XC
-        CM can be followed by I+,IV,V,IX,X+,XL,L,XC
-        D  can be followed by I+,IV,V,IX,X+,XL,L,XC,C+ (rule 2 disallows CD,CM)
-        M+ can be followed by I+,IV,V,IX,X+,XL,L,XC,C+,CD,D,CM
-    */
-
-    const int first_prefix = first.type==PAIR ? first.prefix : first.digit;
-
-    if (first_prefix == 5 || first_prefix == 50 || first_prefix == 500) {
-        const int second_suffix = second.type==PAIR ? second.suffix : second.digit;
-        return first_prefix > second_suffix;
+static struct result fail(struct rome_ctx* const ctx, const enum rome_error_kind kind, const int offset, const int length,
+                          char const* const fmt, ...) {
+    struct result res = failure(kind, offset, length);
+    if (!ctx->format_errors) {
+        return res;
     }
 
-    const int second_prefix = second.type==PAIR ? second.prefix : second.digit;
-    return first_prefix > second_prefix;
-}
+    va_list args;
+    va_start (args, fmt);
+    const struct result message = verrorf(ctx->allocator, fmt, args);
+    va_end (args);
 
-bool valid_pair(const int prefix, const int suffix) {
-    switch (suffix) {
-        case 5:
-        case 10:
-            return prefix == 1;
-        case 50:
-        case 100:
-            return prefix == 10;
-        case 500:
-        case 1000:
-            return prefix == 100;
-        default:
-            return false;
-    }
+    res.error = message.error;
+    res.allocator = message.allocator;
+    return res;
 }
-
-bool valid_repeats(const int main, const int count) {
-    if (count == 0) {
-        return false;
-    }
-
-    switch (main) {
-        case 5:
-        case 50:
-        case 500:
-            return count==1;
-        case 1:
-        case 10:
-        case 100:
-            return count<4;
-        case 1000:
-            return true;
-        default:
-            return 0;
-    }
-}
-
-bool parse_roman_character(const char c, int *const out) {
-    switch (c) {
-        case 'I':
-            *out = 1;
-            return true;
-        case 'V':
-            *out = 5;
-            return true;
-        case 'X':
-            *out = 10;
-            return true;
-        case 'L':
-            *out = 50;
-            return true;
-        case 'C':
-            *out = 100;
-            return true;
-        case 'D':
-            *out = 500;
-            return true;
-        case 'M':
-            *out = 1000;
-            return true;
-        default:
-            return false;
-    }
-}
-
-char digit_to_roman(const int d) {
-    switch (d) {
-        case 1:
-            return 'I';
-        case 5:
-            return 'V';
-        case 10:
-            return 'X';
-        case 50:
-            return 'L';
-        case 100:
-            return 'C';
-        case 500:
-            return 'D';
-        case 1000:
-            return 'M';
-        default:
-            return '?';
-    }
-}
\ No newline at end of file
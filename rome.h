@@ -1,7 +1,88 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
 #include "result.h"
 
 // Parses a roman number from the string
 // The output is wrapped around a result, and can only be trusted if result error is NULL
-struct result parse_roman_number(char const* str);
\ No newline at end of file
+// Error messages are allocated with the context's allocator. The context's stats are updated.
+// Reentrant: it only writes to ctx and to the returned result.
+struct result rome_parse(struct rome_ctx* ctx, char const* str);
+
+// Parses a roman number from the len bytes at ptr, which need not be null-terminated. Same as rome_parse otherwise.
+struct result rome_parse_n(struct rome_ctx* ctx, char const* ptr, size_t len);
+
+// Parses a roman number from the string with a default context (heap allocator, no stats kept).
+// The output is wrapped around a result, and can only be trusted if result error is NULL
+struct result parse_roman_number(char const* str);
+
+// Returns true if the len bytes at ptr are exactly one canonical roman numeral (no trailing newline).
+// Accepts the same numerals as parse_roman_number, but skips value computation and error reporting altogether.
+bool rome_is_valid(char const* ptr, size_t len);
+
+// Validates n numerals at once, for columnar filters. Numeral i is ptrs[i], of length lens[i].
+// Bit i%64 of valid[i/64] is set if numeral i is valid. valid must hold (n+63)/64 words.
+void rome_is_valid_batch(char const* const* ptrs, size_t const* lens, size_t n, uint64_t* valid);
+
+// Compares the values of two canonical numerals, of lengths alen and blen, without converting them.
+// Returns a negative number, zero or a positive number if a is less than, equal to or greater than b.
+// It stops at the first decimal digit that differs, so e.g. MMXXIV and MCMXC are ordered after reading MM and M.
+// Both inputs must be valid (see rome_is_valid); otherwise the order is unspecified.
+int rome_compare(char const* a, size_t alen, char const* b, size_t blen);
+
+// A numeral that is not necessarily null-terminated
+struct rome_span {
+    char const* ptr;
+    size_t len;
+};
+
+// Sorts an array of valid numerals by increasing value, using rome_compare.
+void rome_sort(struct rome_span* numerals, size_t n);
+
+// Parses n numerals at once, for callers that answer many requests at a time: numerals[i] goes to values[i] and
+// kinds[i]. Error messages are never formatted, so nothing is allocated. The context's stats are updated.
+void rome_parse_batch(struct rome_ctx* ctx, struct rome_span const* numerals, size_t n, int32_t* values,
+                      enum rome_error_kind* kinds);
+
+// Writes the canonical numeral for value to out, null-terminated.
+// Returns its length, or -1 if value is not positive or len bytes are not enough.
+int format_roman(int value, char* out, size_t len);
+
+// Formats n values into one packed buffer, without separators or terminators.
+// Numeral i is written to [out + offsets[i], out + offsets[i+1]), so offsets must hold n+1 entries. Values that are not
+// positive produce empty numerals. out must have room for format_roman_batch_size(vals, n) bytes, which includes a few
+// bytes of slack for the fixed-width stores. Returns the total length of the numerals, which must fit in 32 bits.
+size_t format_roman_batch(int32_t const* vals, size_t n, char* out, uint32_t* offsets);
+
+// Size of the buffer format_roman_batch needs for these values.
+size_t format_roman_batch_size(int32_t const* vals, size_t n);
+
+// Reads a numeral that need not be canonical (IIII, VIIII, IC, MDCCCCX) as the lenient engine does (see context.h),
+// writes its value to *value (unless value is NULL) and its canonical spelling to out (null-terminated, at most outlen
+// bytes). Returns ROME_OK, or ROME_ERROR_EMPTY, ROME_ERROR_BAD_CHARACTER, ROME_ERROR_OVERFLOW or ROME_ERROR_NO_SPACE.
+enum rome_error_kind rome_normalize(char const* ptr, size_t len, int* value, char* out, size_t outlen);
+
+// Normalizes n numerals in one pass, e.g. to clean up a catalogue. The canonical spelling of numeral i is written to
+// out + i*stride (at most stride bytes), its value to values[i] (0 if rejected) and its status to kinds[i].
+void rome_normalize_batch(struct rome_span const* numerals, size_t n, char* out, size_t stride, int32_t* values,
+                          enum rome_error_kind* kinds);
+
+// Checked arithmetic on canonical numerals: a+b, a-b and a*b.
+// The canonical result is written to out (null-terminated, at most outlen bytes). Returns ROME_OK, or why the operands
+// were rejected, ROME_ERROR_OVERFLOW, ROME_ERROR_NO_NUMERAL if the result is not positive, or ROME_ERROR_NO_SPACE.
+enum rome_error_kind rome_add(char const* a, size_t alen, char const* b, size_t blen, char* out, size_t outlen);
+enum rome_error_kind rome_sub(char const* a, size_t alen, char const* b, size_t blen, char* out, size_t outlen);
+enum rome_error_kind rome_mul(char const* a, size_t alen, char const* b, size_t blen, char* out, size_t outlen);
+
+// Element-wise versions over n pairs of numerals. Result i is written to out + i*stride (at most stride bytes) and its
+// status to kinds[i].
+void rome_add_array(struct rome_span const* a, struct rome_span const* b, size_t n, char* out, size_t stride,
+                    enum rome_error_kind* kinds);
+void rome_sub_array(struct rome_span const* a, struct rome_span const* b, size_t n, char* out, size_t stride,
+                    enum rome_error_kind* kinds);
+void rome_mul_array(struct rome_span const* a, struct rome_span const* b, size_t n, char* out, size_t stride,
+                    enum rome_error_kind* kinds);
@@ -0,0 +1,370 @@
+#define _GNU_SOURCE // accept4
+
+#include "serve.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ring.h"
+#include "rome.h"
+
+enum {
+    IN_CAPACITY = sizeof(uint32_t) + SERVE_MAX_REQUEST,
+    // The reply to the largest request: a payload of only newlines
+    OUT_CAPACITY = sizeof(uint32_t) + (SERVE_MAX_REQUEST + 1) * sizeof(struct serve_record),
+    // What the buffers of a connection start at, and shrink back to once it has nothing pending
+    IDLE_CAPACITY = 4096,
+};
+
+// A client. Its buffers are allocated when it first sends something, grow with the requests it has in flight (up to
+// IN_CAPACITY and OUT_CAPACITY) and are reused by the next ones, so a steady client's requests allocate nothing. Once
+// everything it sent is answered, they shrink back to IDLE_CAPACITY, so idle clients cost little.
+struct conn {
+    int fd;
+    uint32_t events; // What epoll is watching for
+    bool eof;        // The client will send nothing else
+    char* in;
+    size_t in_len;   // Bytes of requests received and not answered yet
+    size_t in_capacity;
+    char* out;
+    size_t out_sent; // Bytes of out already sent
+    size_t out_len;  // Bytes of replies in out
+    size_t out_capacity;
+};
+
+static volatile sig_atomic_t stopping = 0;
+static struct rome_ring* volatile serving_ring = NULL; // Shut down on signals, in ring mode
+
+static void stop(const int signal) {
+    (void)signal;
+    stopping = 1;
+    if (serving_ring != NULL) {
+        rome_ring_shutdown(serving_ring); // A lock-free atomic store, so safe in a signal handler
+    }
+}
+
+// Sets stopping on SIGINT and SIGTERM. No SA_RESTART, so that blocking calls return and the loops see the flag.
+static void catch_stop_signals(void) {
+    struct sigaction action = {.sa_handler = stop};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+// Makes room for size bytes in a buffer of *capacity bytes, growing it geometrically up to max. Returns false if memory
+// runs out.
+static bool reserve(char** const buff, size_t* const capacity, const size_t size, const size_t max) {
+    if (size <= *capacity) {
+        return true;
+    }
+    size_t grown = *capacity != 0 ? *capacity : IDLE_CAPACITY;
+    while (grown < size) {
+        grown *= 2;
+    }
+    grown = grown < max ? grown : max;
+    char* const p = realloc(*buff, grown);
+    if (p == NULL) {
+        return false;
+    }
+    *buff = p;
+    *capacity = grown;
+    return true;
+}
+
+// Gives back all but IDLE_CAPACITY bytes of a buffer with nothing in it
+static void shrink(char** const buff, size_t* const capacity) {
+    if (*capacity <= IDLE_CAPACITY) {
+        return;
+    }
+    char* const p = realloc(*buff, IDLE_CAPACITY);
+    if (p != NULL) {
+        *buff = p;
+        *capacity = IDLE_CAPACITY;
+    }
+}
+
+// Writes the reply to a request payload at the end of the output buffer
+static void answer(struct rome_ctx* const ctx, struct conn* const c, char const* payload, const size_t size) {
+    char* const header = c->out + c->out_len;
+    char* it = header + sizeof(uint32_t);
+    uint32_t count = 0;
+
+    // An empty payload is an empty batch. Otherwise there is one numeral more than there are newlines.
+    char const* const end = payload + size;
+    bool more = size > 0;
+    while (more) {
+        char const* const newline = memchr(payload, '\n', (size_t)(end - payload));
+        char const* const numeral_end = newline ? newline : end;
+
+        const struct result res = rome_parse_n(ctx, payload, (size_t)(numeral_end - payload));
+        const struct serve_record record = {.value = res.value, .kind = res.kind};
+        memcpy(it, &record, sizeof(record));
+        it += sizeof(record);
+        ++count;
+
+        more = newline != NULL;
+        payload = numeral_end + 1;
+    }
+
+    memcpy(header, &count, sizeof(count));
+    c->out_len = (size_t)(it - c->out);
+}
+
+// Answers the complete requests received so far, for as long as their replies fit.
+// Returns false if a request is too large or memory runs out.
+static bool answer_all(struct rome_ctx* const ctx, struct conn* const c) {
+    if (c->out_sent == c->out_len) {
+        c->out_sent = c->out_len = 0;
+    }
+
+    size_t pos = 0;
+    while (c->in_len - pos >= sizeof(uint32_t)) {
+        uint32_t size;
+        memcpy(&size, c->in + pos, sizeof(size));
+        if (size > SERVE_MAX_REQUEST) {
+            return false;
+        }
+        if (c->in_len - pos - sizeof(uint32_t) < size) {
+            break; // Not all here yet
+        }
+
+        // The worst case is a payload of only newlines
+        const size_t reply = sizeof(uint32_t) + ((size_t)size + 1) * sizeof(struct serve_record);
+        if (OUT_CAPACITY - c->out_len < reply) {
+            if (c->out_sent == 0) {
+                break; // Wait until the client reads some replies
+            }
+            memmove(c->out, c->out + c->out_sent, c->out_len - c->out_sent);
+            c->out_len -= c->out_sent;
+            c->out_sent = 0;
+            if (OUT_CAPACITY - c->out_len < reply) {
+                break;
+            }
+        }
+        if (!reserve(&c->out, &c->out_capacity, c->out_len + reply, OUT_CAPACITY)) {
+            return false;
+        }
+
+        answer(ctx, c, c->in + pos + sizeof(uint32_t), size);
+        pos += sizeof(uint32_t) + size;
+    }
+
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+    return true;
+}
+
+// Reads whatever the client sent, until the input buffer is full. Returns false on errors.
+static bool receive(struct conn* const c) {
+    while (!c->eof && c->in_len < IN_CAPACITY) {
+        if (!reserve(&c->in, &c->in_capacity, c->in_len + 1, IN_CAPACITY)) {
+            return false;
+        }
+        const ssize_t n = recv(c->fd, c->in + c->in_len, c->in_capacity - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+        } else if (n == 0) {
+            c->eof = true;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sends as many replies as the socket takes. Returns false on errors.
+static bool transmit(struct conn* const c) {
+    while (c->out_sent < c->out_len) {
+        const ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (n >= 0) {
+            c->out_sent += (size_t)n;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Moves a connection forward after epoll woke it up. Returns false when it should be closed.
+static bool pump(struct rome_ctx* const ctx, const int epoll, struct conn* const c) {
+    if (!receive(c)) {
+        return false;
+    }
+
+    // Keep going while replies drain straight away, in case requests were waiting for room
+    size_t before;
+    do {
+        before = c->in_len;
+        if (!answer_all(ctx, c) || !transmit(c)) {
+            return false;
+        }
+    } while (c->in_len != before && c->out_sent == c->out_len);
+
+    const bool pending = c->out_sent < c->out_len;
+    if (c->eof && !pending) {
+        return false; // Everything complete was answered. An unfinished request is dropped.
+    }
+    if (c->in_len == 0 && !pending) {
+        c->out_sent = c->out_len = 0;
+        shrink(&c->in, &c->in_capacity);
+        shrink(&c->out, &c->out_capacity);
+    }
+
+    const uint32_t events = (!c->eof && c->in_len < IN_CAPACITY ? EPOLLIN : 0) | (pending ? EPOLLOUT : 0);
+    if (events != c->events) {
+        struct epoll_event ev = {.events = events, .data.ptr = c};
+        if (epoll_ctl(epoll, EPOLL_CTL_MOD, c->fd, &ev) != 0) {
+            return false;
+        }
+        c->events = events;
+    }
+    return true;
+}
+
+// Accepts every pending connection
+static void accept_all(const int epoll, const int listener) {
+    while (true) {
+        const int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("rome: accept");
+            }
+            return;
+        }
+
+        struct conn* const c = malloc(sizeof(*c));
+        if (c == NULL) {
+            close(fd);
+            continue;
+        }
+        *c = (struct conn) {.fd = fd, .events = EPOLLIN};
+
+        struct epoll_event ev = {.events = c->events, .data.ptr = c};
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            free(c);
+        }
+    }
+}
+
+static void close_conn(const int epoll, struct conn* const c) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+int serve(struct rome_ctx* const ctx, char const* const path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "rome: socket path is too long: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Nothing reads the messages, so nothing is allocated per numeral
+    ctx->format_errors = false;
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        perror("rome: socket");
+        return EXIT_FAILURE;
+    }
+    if (bind(listener, (struct sockaddr const*)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        perror(path);
+        close(listener);
+        return EXIT_FAILURE;
+    }
+
+    const int epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &ev) != 0) {
+        perror("rome: epoll");
+        close(listener);
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+
+    catch_stop_signals();
+
+    int status = EXIT_SUCCESS;
+    struct epoll_event events[64];
+    while (!stopping) {
+        const int n = epoll_wait(epoll, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("rome: epoll_wait");
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            struct conn* const c = events[i].data.ptr;
+            if (c == NULL) {
+                accept_all(epoll, listener);
+            } else if (!pump(ctx, epoll, c)) {
+                close_conn(epoll, c);
+            }
+        }
+    }
+
+    // Connections still open are dropped along with the process
+    close(epoll);
+    close(listener);
+    unlink(path);
+    return status;
+}
+
+int serve_ring(struct rome_ctx* const ctx, char const* const name, const uint32_t slots) {
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        perror(name);
+        return EXIT_FAILURE;
+    }
+
+    const size_t size = rome_ring_size(slots);
+    void* const memory = ftruncate(fd, (off_t)size) == 0
+        ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+        : MAP_FAILED;
+    close(fd);
+    if (memory == MAP_FAILED) {
+        perror(name);
+        shm_unlink(name);
+        return EXIT_FAILURE;
+    }
+
+    struct rome_ring* const ring = rome_ring_init(memory, size, slots);
+    if (ring == NULL) {
+        fprintf(stderr, "rome: the number of slots must be a power of two, at least 4: %u\n", slots);
+        munmap(memory, size);
+        shm_unlink(name);
+        return EXIT_FAILURE;
+    }
+
+    // Only returns zero once a signal shuts the ring down
+    serving_ring = ring;
+    catch_stop_signals();
+    while (rome_ring_work(ctx, ring, true) > 0) {
+    }
+
+    munmap(memory, size);
+    shm_unlink(name);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "context.h"
+
+// Daemon mode: conversions served over a Unix domain socket.
+//
+// Clients send batches of numerals and may pipeline as many as they like before reading the replies, which come back
+// in order. Every integer is in the host's byte order, since both ends run on the same machine.
+//
+//   Request: uint32 size, then size bytes of numerals separated by newlines. A size of zero is an empty batch.
+//   Reply:   uint32 count, then one serve_record per numeral, in request order.
+//
+// A request larger than SERVE_MAX_REQUEST closes the connection.
+
+enum { SERVE_MAX_REQUEST = 1 << 16 };
+
+struct serve_record {
+    int32_t value; // Only meaningful if kind is ROME_OK
+    int32_t kind;  // enum rome_error_kind
+};
+
+// Listens on path and answers requests with ctx until SIGINT or SIGTERM, then removes the socket.
+// Returns an exit status.
+int serve(struct rome_ctx* ctx, char const* path);
+
+// Creates the shared-memory ring name (see ring.h and shm_open) with the given number of slots, and answers it with ctx
+// until SIGINT or SIGTERM, then removes it. Returns an exit status.
+int serve_ring(struct rome_ctx* ctx, char const* name, uint32_t slots);
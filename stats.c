@@ -0,0 +1,151 @@
+#include "stats.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "instrument.h"
+
+#if ROME_STATS || ROME_LATENCY
+
+#include <pthread.h>
+#include <stdlib.h>
+
+static _Atomic(struct stats_slot*) slots = NULL;
+_Thread_local struct stats_slot* thread_stats = NULL;
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+// Hands the slot of an exiting thread to the next thread that needs one
+static void release(void* const slot) {
+    atomic_store_explicit(&((struct stats_slot*)slot)->in_use, false, memory_order_release);
+}
+
+static void create_exit_key(void) {
+    pthread_key_create(&exit_key, release);
+}
+
+// Finds a free slot, or adds one
+static struct stats_slot* claim(void) {
+    for (struct stats_slot* s = atomic_load_explicit(&slots, memory_order_acquire); s != NULL; s = s->next) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong_explicit(&s->in_use, &expected, true, memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            return s;
+        }
+    }
+
+    // Zeroed memory is a valid state for the counters
+    struct stats_slot* const s = aligned_alloc(_Alignof(struct stats_slot), sizeof(struct stats_slot));
+    if (s == NULL) {
+        return NULL;
+    }
+    memset(s, 0, sizeof(*s));
+    atomic_init(&s->in_use, true);
+    s->next = atomic_load_explicit(&slots, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&slots, &s->next, s, memory_order_release, memory_order_relaxed)) {
+    }
+    return s;
+}
+
+struct stats_slot* claim_thread_stats(void) {
+    struct stats_slot* const s = claim();
+    if (s != NULL) {
+        pthread_once(&exit_key_once, create_exit_key);
+        pthread_setspecific(exit_key, s);
+        thread_stats = s;
+    }
+    return s;
+}
+
+// Adds n counters of a slot into sum
+static void add_up(unsigned long long* const sum, _Atomic unsigned long long const* const counters, const int n) {
+    for (int i = 0; i < n; ++i) {
+        sum[i] += atomic_load_explicit(&counters[i], memory_order_relaxed);
+    }
+}
+
+#endif
+
+struct rome_rejections rome_stats_snapshot(void) {
+    struct rome_rejections sum;
+    memset(&sum, 0, sizeof(sum));
+#if ROME_STATS
+    for (struct stats_slot* s = atomic_load_explicit(&slots, memory_order_acquire); s != NULL; s = s->next) {
+        add_up(sum.by_kind, s->rejections, ROME_ERROR_KINDS);
+    }
+#endif
+    return sum;
+}
+
+bool rome_latency_snapshot(struct rome_latency* const out) {
+    memset(out, 0, sizeof(*out));
+#if ROME_LATENCY
+    for (struct stats_slot* s = atomic_load_explicit(&slots, memory_order_acquire); s != NULL; s = s->next) {
+        add_up(out->accepted.counts, s->ticks[false], ROME_HISTOGRAM_BUCKETS);
+        add_up(out->rejected.counts, s->ticks[true], ROME_HISTOGRAM_BUCKETS);
+        add_up(out->lengths.counts, s->lengths, ROME_HISTOGRAM_BUCKETS);
+        add_up(out->length_ticks, s->length_ticks, ROME_HISTOGRAM_BUCKETS);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned long long rome_histogram_floor(const int bucket) {
+    if (bucket < ROME_HISTOGRAM_SUB_BUCKETS) {
+        return (unsigned long long)bucket;
+    }
+    const int shift = bucket / ROME_HISTOGRAM_SUB_BUCKETS - 1;
+    return (unsigned long long)(ROME_HISTOGRAM_SUB_BUCKETS + bucket % ROME_HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+unsigned long long rome_histogram_percentile(struct rome_histogram const* const h, const double percentile) {
+    unsigned long long total = 0;
+    for (int i = 0; i < ROME_HISTOGRAM_BUCKETS; ++i) {
+        total += h->counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // The rank of the percentile, counting from 1
+    unsigned long long rank = (unsigned long long)(percentile / 100.0 * (double)total + 0.5);
+    rank = rank < 1 ? 1 : rank > total ? total : rank;
+    unsigned long long seen = 0;
+    for (int i = 0; i < ROME_HISTOGRAM_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            return rome_histogram_floor(i);
+        }
+    }
+    return 0;
+}
+
+#if ROME_LATENCY
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+#endif
+
+double rome_ticks_per_ns(void) {
+#if ROME_LATENCY
+    static _Atomic double measured = 0;
+    double ratio = atomic_load_explicit(&measured, memory_order_relaxed);
+    if (ratio == 0) {
+        // Spins for 10 ms against the monotonic clock
+        const double start_ns = now_ns();
+        const uint64_t start = read_ticks();
+        double elapsed;
+        while ((elapsed = now_ns() - start_ns) < 1e7) {
+        }
+        ratio = (double)(read_ticks() - start) / elapsed;
+        atomic_store_explicit(&measured, ratio, memory_order_relaxed);
+    }
+    return ratio;
+#else
+    return 1;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "result.h"
+
+// Process-wide instrumentation of the parser.
+//
+// Every thread records into its own cache-line-aligned slot, so recording never contends and costs a few instructions.
+// A snapshot adds up the slots of all threads, including threads that have exited (their slots are handed to new
+// threads, counts and all). Other threads keep recording meanwhile, so a snapshot is not an atomic picture, but every
+// record is eventually seen.
+//
+// Two parts can be compiled in, each with a CMake option of the same name:
+//  - ROME_STATS (on by default) counts rejected inputs by reason, only on the rejection path: those of rome_parse,
+//    rome_parse_n, parse_roman_number and the push parser (stream.h), but not the operands of the arithmetic in rome.h.
+//  - ROME_LATENCY (off by default) times every call to rome_parse, rome_parse_n and parse_roman_number with the
+//    processor's tick counter, and records the time and the input length.
+// Snapshots of a part that is compiled out are all zeros.
+
+enum { ROME_ERROR_KINDS = ROME_ERROR_OTHER + 1 };
+
+struct rome_rejections {
+    unsigned long long by_kind[ROME_ERROR_KINDS]; // Indexed by enum rome_error_kind. ROME_OK is always zero.
+};
+
+// Adds up the rejection counters of every thread.
+struct rome_rejections rome_stats_snapshot(void);
+
+enum {
+    ROME_HISTOGRAM_SUB_BITS = 3,
+    ROME_HISTOGRAM_SUB_BUCKETS = 1 << ROME_HISTOGRAM_SUB_BITS,
+    ROME_HISTOGRAM_BUCKETS = (64 - ROME_HISTOGRAM_SUB_BITS + 1) * ROME_HISTOGRAM_SUB_BUCKETS,
+};
+
+// Log-linear histogram, as in HdrHistogram: values below 8 have a bucket each, and every power of two above is split
+// into 8 buckets, so a bucket's values are within 12.5% of each other. Covers all 64-bit values.
+struct rome_histogram {
+    unsigned long long counts[ROME_HISTOGRAM_BUCKETS];
+};
+
+// Smallest value that falls in a bucket.
+unsigned long long rome_histogram_floor(int bucket);
+
+// Smallest value of the bucket that holds the given percentile (0 to 100) of the recorded values, or 0 if empty.
+unsigned long long rome_histogram_percentile(struct rome_histogram const* h, double percentile);
+
+struct rome_latency {
+    struct rome_histogram accepted; // Ticks per call that returned a value
+    struct rome_histogram rejected; // Ticks per call that returned an error, including formatting its message
+    struct rome_histogram lengths;  // Input lengths in bytes
+    unsigned long long length_ticks[ROME_HISTOGRAM_BUCKETS]; // Total ticks of the calls in each bucket of lengths
+};
+
+// Adds up the latency histograms of every thread into out. Returns false if ROME_LATENCY is compiled out.
+bool rome_latency_snapshot(struct rome_latency* out);
+
+// Ticks per nanosecond of the counter behind the latency histograms. Measured on the first call, which takes ~10 ms.
+double rome_ticks_per_ns(void);
@@ -0,0 +1,137 @@
+#include "stream.h"
+
+#include "instrument.h"
+#include "probes.h"
+
+/*
+ * The stream parser runs the same tokenizer as scan_token, one byte at a time. A token is only complete once the byte
+ * after it is seen (II may still become III, I may still become IV), so the token being read is kept as a digit and a
+ * count, and checked with valid_repeats and valid_sequence when the next token starts or the numeral ends.
+ */
+
+void rome_stream_init(struct rome_stream* const stream, const rome_event_fn on_event, void* const user) {
+    *stream = (struct rome_stream) {
+        .on_event = on_event,
+        .user = user,
+    };
+}
+
+static bool is_delimiter(const char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Marks the current numeral as rejected by the byte at offset. Later bytes are skipped until the delimiter.
+static void reject(struct rome_stream* const stream, const enum rome_error_kind kind, const uint64_t offset) {
+    count_rejection(kind);
+    ROME_PROBE3(reject, (int)kind, offset, 0);
+    stream->current.kind = kind;
+    stream->current.error_offset = offset;
+}
+
+// Checks a complete token against the previous one and adds it up. offset is where the token starts.
+static void commit(struct rome_stream* const stream, const struct token t, const uint64_t offset) {
+    if (stream->has_prev && !valid_sequence(stream->prev, t)) {
+        reject(stream, ROME_ERROR_BAD_SEQUENCE, offset);
+        return;
+    }
+    if (!add_token_value(&stream->current.value, t)) {
+        reject(stream, ROME_ERROR_OVERFLOW, stream->current.offset);
+        return;
+    }
+    ROME_PROBE3(token, offset, t.type == PAIR ? 2 : t.count, token_value(t));
+    stream->prev = t;
+    stream->has_prev = true;
+}
+
+// Completes the run being read, which ended right before the byte at offset
+static void commit_run(struct rome_stream* const stream, const uint64_t offset) {
+    const uint64_t start = offset - (uint64_t)stream->count;
+    if (!valid_repeats(stream->digit, stream->count)) {
+        reject(stream, ROME_ERROR_BAD_REPEAT, start);
+        return;
+    }
+    commit(stream, (struct token) {.type = REPEAT, .digit = stream->digit, .count = stream->count}, start);
+}
+
+static void end_numeral(struct rome_stream* const stream) {
+    if (stream->current.kind == ROME_OK && stream->digit != 0) {
+        commit_run(stream, stream->offset);
+    }
+    stream->current.length = stream->offset - stream->current.offset;
+    if (stream->current.kind != ROME_OK) {
+        stream->current.value = 0;
+    }
+    stream->on_event(stream->user, &stream->current);
+
+    stream->in_numeral = false;
+    stream->has_prev = false;
+    stream->digit = 0;
+    stream->count = 0;
+}
+
+static void push(struct rome_stream* const stream, const char c) {
+    if (is_delimiter(c)) {
+        if (stream->in_numeral) {
+            end_numeral(stream);
+        }
+        return;
+    }
+
+    if (!stream->in_numeral) {
+        stream->in_numeral = true;
+        stream->current = (struct rome_event) {.kind = ROME_OK, .offset = stream->offset};
+    }
+
+    if (stream->current.kind != ROME_OK) {
+        return;
+    }
+
+    int d;
+    if (!parse_roman_character(c, &d)) {
+        // Like scan_token, a finished run is checked first, but a lonely digit is not (it could have been a pair)
+        if (stream->count > 1) {
+            commit_run(stream, stream->offset);
+        }
+        if (stream->current.kind == ROME_OK) {
+            reject(stream, ROME_ERROR_BAD_CHARACTER, stream->offset);
+        }
+        return;
+    }
+
+    if (stream->digit == 0) {
+        // First digit of a token
+        stream->digit = d;
+        stream->count = 1;
+    } else if (d == stream->digit) {
+        // The run goes on
+        stream->count++;
+    } else if (stream->count == 1 && stream->digit < d) {
+        // It's a pair!
+        const uint64_t start = stream->offset - 1;
+        if (!valid_pair(stream->digit, d)) {
+            reject(stream, ROME_ERROR_BAD_PAIR, start);
+            return;
+        }
+        commit(stream, (struct token) {.type = PAIR, .prefix = stream->digit, .suffix = d}, start);
+        stream->digit = 0;
+        stream->count = 0;
+    } else {
+        // The run is over, and this digit starts the next token
+        commit_run(stream, stream->offset);
+        stream->digit = d;
+        stream->count = 1;
+    }
+}
+
+void rome_stream_feed(struct rome_stream* const stream, char const* const bytes, const size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        push(stream, bytes[i]);
+        stream->offset++;
+    }
+}
+
+void rome_stream_finish(struct rome_stream* const stream) {
+    if (stream->in_numeral) {
+        end_numeral(stream);
+    }
+}
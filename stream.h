@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result.h"
+#include "token.h"
+
+// Outcome of one numeral in a stream
+struct rome_event {
+    int value;                 // Value of the numeral. Only meaningful if kind is ROME_OK.
+    enum rome_error_kind kind; // ROME_OK, or why the numeral was rejected
+    uint64_t offset;           // Offset of the numeral in the stream
+    uint64_t length;           // Length of the numeral in bytes
+    uint64_t error_offset;     // Offset in the stream of the first rejected byte (failures only)
+};
+
+// Receives the events of a stream, with the user pointer given to rome_stream_init
+typedef void (*rome_event_fn)(void* user, struct rome_event const* event);
+
+// Push parser for numerals arriving in arbitrary chunks, e.g. from a socket or a pipe.
+// Numerals are separated by whitespace (space, tab, carriage return or newline), and may be split across any number of
+// calls to rome_stream_feed. Nothing is buffered: the state is the token being read and the last complete token, which
+// is all valid_sequence needs. Empty numerals (consecutive delimiters) produce no event.
+struct rome_stream {
+    rome_event_fn on_event;
+    void* user;
+
+    uint64_t offset;           // Bytes fed so far
+    struct rome_event current; // Numeral being read
+    bool in_numeral;           // Whether a numeral has started and its delimiter has not been seen yet
+
+    struct token prev;         // Last complete token of the current numeral
+    bool has_prev;
+    int digit;                 // Digit of the token being read. Zero if there is none.
+    int count;                 // Times digit has been seen in a row
+};
+
+// Initializes a stream that reports numerals to on_event.
+void rome_stream_init(struct rome_stream* stream, rome_event_fn on_event, void* user);
+
+// Feeds the next n bytes of the stream. on_event is called for every numeral whose delimiter is among them.
+void rome_stream_feed(struct rome_stream* stream, char const* bytes, size_t n);
+
+// Signals the end of the stream, reporting the last numeral if it was not followed by a delimiter.
+void rome_stream_finish(struct rome_stream* stream);
@@ -0,0 +1,70 @@
+#include "roman_table.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum { HEADER_SIZE = 16 };
+
+// Whether the offsets of a mapped file never decrease and end at text_size, so every numeral is within the text
+static bool valid_offsets(uint32_t const* const offsets, const uint32_t text_size) {
+    for (int v = 0; v <= ROMAN_TABLE_MAX; ++v) {
+        if (offsets[v] > offsets[v + 1]) {
+            return false;
+        }
+    }
+    return offsets[ROMAN_TABLE_MAX + 1] == text_size;
+}
+
+bool roman_table_map(struct roman_table* const table, char const* const path) {
+    if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+        return false;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE + sizeof(roman_table_offsets)) {
+        close(fd);
+        return false;
+    }
+
+    const size_t size = (size_t)st.st_size;
+    void* const map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    char const* const base = map;
+    uint32_t max, text_size;
+    memcpy(&max, base + 8, sizeof(max));
+    memcpy(&text_size, base + 12, sizeof(text_size));
+
+    uint32_t const* const offsets = (uint32_t const*)(base + HEADER_SIZE);
+    if (memcmp(base, ROMAN_TABLE_MAGIC, 8) != 0
+        || max != ROMAN_TABLE_MAX
+        || size != HEADER_SIZE + sizeof(roman_table_offsets) + text_size
+        || !valid_offsets(offsets, text_size)) {
+        munmap(map, size);
+        return false;
+    }
+
+    *table = (struct roman_table) {
+        .offsets = offsets,
+        .text = base + HEADER_SIZE + sizeof(roman_table_offsets),
+        .map = map,
+        .map_size = size,
+    };
+    return true;
+}
+
+void roman_table_unmap(struct roman_table* const table) {
+    munmap(table->map, table->map_size);
+    *table = (struct roman_table) {0};
+}
@@ -0,0 +1,176 @@
+#include <assert.h>
+
+#include "token.h"
+
+int token_value(const struct token t) {
+    switch (t.type) {
+        case REPEAT:
+            return t.digit * t.count;
+        case PAIR:
+            return t.suffix - t.prefix;
+        default:
+            assert(false);
+            __builtin_unreachable();
+    }
+}
+
+bool add_token_value(int* const tally, const struct token t) {
+    int value;
+    if (t.type == REPEAT) {
+        if (__builtin_mul_overflow(t.digit, t.count, &value)) {
+            return false;
+        }
+    } else {
+        value = token_value(t);
+    }
+    return !__builtin_add_overflow(*tally, value, tally);
+}
+
+bool sprint_token(char *const buff, const int len, const struct token t) {
+    switch (t.type) {
+        case REPEAT: {
+            if (len < t.count+1) {
+                return false;
+            }
+            const char d = digit_to_roman(t.digit);
+            for (int i = 0; i<t.count; ++i) {
+                buff[i] = d;
+            }
+            buff[t.count] = '\0';
+            return true;
+        }
+        case PAIR: {
+            if (len < 3) {
+                return false;
+            }
+            buff[0] = digit_to_roman(t.prefix);
+            buff[1] = digit_to_roman(t.suffix);
+            buff[2] = '\0';
+            return true;
+        }
+        default:
+            assert(false);
+            __builtin_unreachable();
+    }
+}
+
+bool valid_sequence(const struct token first, const struct token second) {
+    /*
+    I have determined that the following two rules are true:
+        1. The first character of consecutive tokens must decrease (XXX can be followed by IX because X<I)
+        2. If the first token is V, L or D; the following must also decrease in last character (V cannot be followed by IV because V=V)
+    These rules exclude things like XX followed by X, because this would have been tokenized as XXX.
+    They also exclude invalid tokens like VC, IM, LL, etc.
+
+    See the rules expanded (A+ means any of A,AA,AAA):
+        I+ is terminal
+        IV is terminal
+        IX is terminal
+        V  can be followed by I+ (rule 2 disallows IV,IX)
+        X+ can be followed by I+,IV,V,IX
+        XL can be followed by I+,IV,V,IX
+        XC can be followed by I+,IV,V,IX
+        L  can be followed by I+,IV,V,IX,X+ (rule 2 disallows XL,XC)
+        C+ can be followed by I+,IV,V,IX,X+,XL,L,XC
+        CD can be followed by I+,IV,V,IX,X+,XL,L,XC
+        CM can be followed by I+,IV,V,IX,X+,XL,L,XC
+        D  can be followed by I+,IV,V,IX,X+,XL,L,XC,C+ (rule 2 disallows CD,CM)
+        M+ can be followed by I+,IV,V,IX,X+,XL,L,XC,C+,CD,D,CM
+    */
+
+    const int first_prefix = first.type==PAIR ? first.prefix : first.digit;
+
+    if (first_prefix == 5 || first_prefix == 50 || first_prefix == 500) {
+        const int second_suffix = second.type==PAIR ? second.suffix : second.digit;
+        return first_prefix > second_suffix;
+    }
+
+    const int second_prefix = second.type==PAIR ? second.prefix : second.digit;
+    return first_prefix > second_prefix;
+}
+
+bool valid_pair(const int prefix, const int suffix) {
+    switch (suffix) {
+        case 5:
+        case 10:
+            return prefix == 1;
+        case 50:
+        case 100:
+            return prefix == 10;
+        case 500:
+        case 1000:
+            return prefix == 100;
+        default:
+            return false;
+    }
+}
+
+bool valid_repeats(const int main, const int count) {
+    if (count == 0) {
+        return false;
+    }
+
+    switch (main) {
+        case 5:
+        case 50:
+        case 500:
+            return count==1;
+        case 1:
+        case 10:
+        case 100:
+            return count<4;
+        case 1000:
+            return true;
+        default:
+            return 0;
+    }
+}
+
+bool parse_roman_character(const char c, int *const out) {
+    switch (c) {
+        case 'I':
+            *out = 1;
+            return true;
+        case 'V':
+            *out = 5;
+            return true;
+        case 'X':
+            *out = 10;
+            return true;
+        case 'L':
+            *out = 50;
+            return true;
+        case 'C':
+            *out = 100;
+            return true;
+        case 'D':
+            *out = 500;
+            return true;
+        case 'M':
+            *out = 1000;
+            return true;
+        default:
+            return false;
+    }
+}
+
+char digit_to_roman(const int d) {
+    switch (d) {
+        case 1:
+            return 'I';
+        case 5:
+            return 'V';
+        case 10:
+            return 'X';
+        case 50:
+            return 'L';
+        case 100:
+            return 'C';
+        case 500:
+            return 'D';
+        case 1000:
+            return 'M';
+        default:
+            return '?';
+    }
+}
\ No newline at end of file
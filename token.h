@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "result.h"
+
+// Internal header: the tokenizer behind parse_roman_number, shared by the modules that work on token streams. The rules
+// on tokens are in token.c, which gen_table builds on; the scanners are in rome.c.
+
+enum token_type {
+    PAIR,     // Prefix-suffix pair  (IV, XC, etc.)
+    REPEAT    // Repeated value (I, II, CCC, etc.). Single-numerals (I, L) are considered trivial repeats.
+};
+
+struct token {
+    enum token_type type; // Type of token
+    union {
+        // When parsing a pair
+        struct {
+            int prefix;
+            int suffix;
+        };
+        // When parsing repeated digits
+        struct {
+            int digit;
+            int count;
+        };
+    };
+};
+
+// Why scan_token rejected its input, and where (relative to the start of the token)
+struct scan_error {
+    enum rome_error_kind kind;
+    int offset;
+    int length;
+};
+
+// Converts a token into its numeral value (e.g. XC returns 90)
+int token_value(struct token t);
+
+// Adds the value of t to *tally. Returns false if it overflows, which a long enough run of M does on its own.
+bool add_token_value(int* tally, struct token t);
+
+// Converts one-character digits to their character.
+// This means 1, 5, 10, etc. are valid inputs, but 2, 9, 600 are not.
+char digit_to_roman(int d);
+
+// Writes a token to a buffer of length 'len'. It returns true if the buffer was large enough to fit the string.
+// 4 bytes is enough to fit any token.
+bool sprint_token(char* buff, int len, struct token t);
+
+// Checks that a prefix-suffix pair is valid: IV is good but LC is not.
+bool valid_pair(int prefix, int suffix);
+
+// Checks that a repetition is valid. III is good but LL is not.
+bool valid_repeats(int main, int count);
+
+// Checks that two tokens can go one after another. (C)(I) is good but (IX)(I) is not.
+bool valid_sequence(struct token first, struct token second);
+
+// Parses the numerical value of a character into *out. Returns false if the character is not a roman numeral.
+bool parse_roman_character(char c, int *out);
+
+// Reads the token starting at str (and ending no later than end) into t.
+// Returns the count of characters consumed, or 0 if the token is invalid, in which case err says why.
+// It never allocates, so it is shared by every engine that needs tokens but not error messages.
+int scan_token(char const* str, char const* end, struct token* t, struct scan_error* err);
+
+// Reads the whole numeral in [str, end) and writes its value to *value.
+// Returns false if it is not a valid numeral, in which case err says why (relative to str). It never allocates.
+bool scan_numeral(char const* str, char const* end, int* value, struct scan_error* err);
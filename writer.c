@@ -0,0 +1,104 @@
+#include "writer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "probes.h"
+
+// Longest decimal int, with its sign
+enum { MAX_INT_LEN = 11 };
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+void writer_init(struct writer* const w, const int fd) {
+    w->fd = fd;
+    w->failed = false;
+    w->len = 0;
+}
+
+bool writer_flush(struct writer* const w) {
+    ROME_PROBE1(write, w->len);
+    size_t done = 0;
+    while (!w->failed && done < w->len) {
+        const ssize_t n = write(w->fd, w->buff + done, w->len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            w->failed = true;
+            break;
+        }
+        done += (size_t)n;
+    }
+    w->len = 0;
+    return !w->failed;
+}
+
+void writer_put(struct writer* const w, char const* s, size_t n) {
+    if (n == 0) {
+        return; // s may be NULL
+    }
+    while (n > sizeof(w->buff) - w->len) {
+        const size_t room = sizeof(w->buff) - w->len;
+        memcpy(w->buff + w->len, s, room);
+        w->len += room;
+        s += room;
+        n -= room;
+        writer_flush(w);
+    }
+    memcpy(w->buff + w->len, s, n);
+    w->len += n;
+}
+
+void writer_put_str(struct writer* const w, char const* const s) {
+    writer_put(w, s, strlen(s));
+}
+
+void writer_put_char(struct writer* const w, const char c) {
+    if (w->len == sizeof(w->buff)) {
+        writer_flush(w);
+    }
+    w->buff[w->len++] = c;
+}
+
+void writer_put_int(struct writer* const w, const int value) {
+    if (sizeof(w->buff) - w->len < MAX_INT_LEN) {
+        writer_flush(w);
+    }
+
+    // Digits are produced two at a time from the end, into a scratch buffer
+    char digits[MAX_INT_LEN];
+    char* p = digits + sizeof(digits);
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    while (u >= 100) {
+        const unsigned int pair = u % 100;
+        u /= 100;
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * pair, 2);
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * u, 2);
+    } else {
+        *--p = (char)('0' + u);
+    }
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    const size_t n = (size_t)(digits + sizeof(digits) - p);
+    memcpy(w->buff + w->len, p, n);
+    w->len += n;
+}
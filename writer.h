@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Buffered output for the CLI. Everything is accumulated in one large buffer and handed to write(2) in big blocks,
+// instead of going through printf for every line.
+struct writer {
+    int fd;
+    bool failed;      // Set once a write fails. Later output is dropped.
+    size_t len;       // Bytes waiting in buff
+    char buff[1 << 16];
+};
+
+// Initializes a writer for a file descriptor.
+void writer_init(struct writer* w, int fd);
+
+// Appends n bytes.
+void writer_put(struct writer* w, char const* s, size_t n);
+
+// Appends a null-terminated string.
+void writer_put_str(struct writer* w, char const* s);
+
+// Appends one byte.
+void writer_put_char(struct writer* w, char c);
+
+// Appends the decimal representation of value.
+void writer_put_int(struct writer* w, int value);
+
+// Writes out everything buffered so far. Returns false if any write failed.
+bool writer_flush(struct writer* w);